@@ -67,41 +67,14 @@ time_t convert(const Time time) {
 	return timestamp;
 }
 
-string convert16(char16_t utf16) {
-	string utf8;
-	utf8.push_back(0xC0 | ((utf16 >> 6) & 0x1F));
-	utf8.push_back(0x80 | (utf16 & 0x3F));
-	return utf8;
-}
-
+// name of UTF-16 units, up to 255 for NTFS names, transcoded on stack and copied once
 string fixName(const char16_t* start, const char16_t* stop)
 {
-	string name;
-	union __attribute__ ((packed)) chrs{
-		char16_t    wch;
-		struct {
-			char    lch;
-			char    hch;
-		};
-	};
-	const chrs* wch = reinterpret_cast<const chrs*>(start);
-	const chrs* end = reinterpret_cast<const chrs*>(stop);
-	while (wch < end) {
-		if ((wch->wch & 0xC0) == 0x80);
-		else if ((wch->wch & 0xEC) == 0xC8) {
-			if (wch->hch) {
-				name.push_back(wch->lch);
-				name.push_back(wch->hch);
-			}
-			else if (((wch+1)->wch & 0xC0) == 0x80) {
-				name.push_back(wch++->lch);
-				name.push_back(wch->lch);
-			}
-		}
-		else if (!wch->hch && !(wch->lch & 0x80)) name.push_back(wch->lch);
-		else name.append(convert16(wch->wch));
-		wch++;
-	}
+	char buffer[255 * 3];
+	size_t size = stop > start? stop - start: 0;
+	if (size <= 255) return string(buffer, utf8(start, size, buffer));
+	string name(size * 3, 0);
+	name.resize(utf8(start, size, name.data()));
 	return name;
 }
 
@@ -121,21 +94,11 @@ ostream& operator<<(ostream& os, const Info* attr) {
 }
 
 ostream& operator<<(ostream& os, const Name* attr) {
-	string path = attr->getName();
-	uint16_t dir = attr->dir;
-	try {
-		string name;
-		uint16_t last = 0;
-		while (true) {
-			last = dir;
-			tie(name, dir) = File::dirs.at(dir);
-			if (dir == last) break;
-			path = name.append("/").append(path);
-		}
-	}
-	catch (...) {
-		path = string("@").append(to_string(dir)).append("/").append(path);
-	}
+	string path;
+	bool trash;
+	uint64_t dir;
+	if (File::dirs.path(attr->dir, path, trash, dir)) path = path.substr(1) + attr->getName();
+	else path = "@" + to_string(dir) + path + attr->getName();
 	os << "NAME: " << path;
 	if (attr->length <= 16) os << tab; else os << endl;
 	pdump(attr->data, attr->data + attr->length);
@@ -274,11 +237,11 @@ ostream& operator<<(ostream& os, const Nonres* attr) {
 	os << "runlist: ";
 	os.flush();
 	bool many = false;
-	while (count && runlist->lenSize && runlist->offSize) {
+	while (count && runlist->lenSize) {
 		uint64_t lenMask = ((1LL<<(8*runlist->lenSize))-1LL);
 		int64_t shift = runlist->run >> (8*runlist->lenSize);
 		auto offMask = ((1LL<<(8*runlist->offSize))-1LL);
-		offset = shift & offMask;
+		offset = runlist->offSize? shift & offMask: 0;		// sparse run if no offset
 		length = runlist->run & (lenMask);
 		if (Context::debug && many) os << tab;
 		os << outpair(runlist->offSize, runlist->lenSize) << ':' << outpaix(offset, length) 
@@ -329,11 +292,7 @@ bool Name::parse(File* file) const {
 	file->parent = dir;
 	file->valid = !name.empty();
 
-	// find file extension for matching include/exclude parameter
-	if (file->name.npos != file->name.find('.')) {
-		istringstream ext(file->name);
-		while (getline(ext, file->ext, '.'));
-	}
+	file->setExt();
 
 	return file->valid;
 }
@@ -342,20 +301,20 @@ ostream& operator<<(ostream& os, const Runlist* attr) {
 	return os << "Runlist::operator<< not implemented" << endl;
 }
 
-uint64_t Runlist::minLcn = 0xFFFFFFFFFFFFFFFF;
-uint64_t Runlist::maxLcn = 0;
+thread_local uint64_t Runlist::minLcn = 0xFFFFFFFFFFFFFFFF;
+thread_local uint64_t Runlist::maxLcn = 0;
 
-vector<pair<VCN, VCN>> Runlist::parse(File* file, size_t count) const {
-	vector<pair<VCN, VCN>> runlist;
+void Runlist::parse(File* file, size_t count, Run& run) const {
+	auto& runlist = run.list;
 	uint64_t length;
 	int64_t offset;
 	uint64_t first = 0;
 	uint64_t last = 0;
 	const Runlist* attr = this;
-	while (count && attr->lenSize && attr->offSize) {
+	while (count && attr->lenSize) {
 		if (attr->lenSize > 4 || attr->offSize > 4) {
 			if (file) file->error = true;
-			return runlist;
+			return;
 			cerr << *file << endl;
 			confirm("Runlist corrupted");
 		}
@@ -363,6 +322,12 @@ vector<pair<VCN, VCN>> Runlist::parse(File* file, size_t count) const {
 		int64_t shift = attr->run >> (8*attr->lenSize);
 		auto offMask = ((1LL<<(8*attr->offSize))-1LL);
 		length = attr->run & lenMask;
+		if (!attr->offSize) {		// sparse run, no offset and next run relative to previous one
+			runlist.push_back(make_pair(Run::hole, Run::hole + length));
+			count -= min<uint64_t>(count, length);
+			attr = (Runlist*)((char*)attr + 1 + attr->lenSize);
+			continue;
+		}
 		offset = shift & offMask;
 		if (offset & (1LL<<(8*attr->offSize-1))) offset |= (0xFFFFFFFFFFFFFFFF << (8*attr->offSize));
 		first += offset;
@@ -373,7 +338,6 @@ vector<pair<VCN, VCN>> Runlist::parse(File* file, size_t count) const {
 		count -= last - first;
 		attr = (Runlist*)((char*)attr + 1 + attr->lenSize + attr->offSize);
 	}
-	return runlist;
 }
 
 const Name* Attr::getName() const {
@@ -381,6 +345,18 @@ const Name* Attr::getName() const {
 	else return nullptr;
 }
 
+const Info* Attr::getInfo() const {
+	if (type == AttrId::StandardInfo && !noRes)
+		return reinterpret_cast<const Info*>((char*)this + static_cast<const Resident*>(this)->offset);
+	else return nullptr;
+}
+
+// nonresident data, no alternate data stream
+const Nonres* Attr::getData() const {
+	if (type == AttrId::Data && noRes && !length) return static_cast<const Nonres*>(this);
+	else return nullptr;
+}
+
 bool Root::parse(File* file) const {
 	return header->parse(file);
 }
@@ -404,20 +380,38 @@ bool Header::parse(File* file) const {
 	return true;
 }
 
-const Attr* Attr::parse(File* file) const {
-	if (noRes) static_cast<const Nonres*>(this)->parse(file);
-	else static_cast<const Resident*>(this)->parse(file);
+const Attr* Attr::head(File* file) const {
+	if (auto info = getInfo()) info->parse(file);
+	else if (auto name = getName()) name->parse(file);
+	else if (noRes && ((type == AttrId::Data && !length) || type == AttrId::IndexAllocation)) {
+		auto attr = static_cast<const Nonres*>(this);
+		file->size = attr->used & 0xFFFFFFFFFFFF;
+		file->alloc = attr->alloc & 0xFFFFFFFFFFFF;
+	}
 	return getNext();
 }
 
+bool Attr::deferred() const {
+	return type == AttrId::Data || type == AttrId::IndexRoot || type == AttrId::IndexAllocation || type == AttrId::Bitmap;
+}
+
+bool Attr::parse(File* file) const {
+	if (noRes) return static_cast<const Nonres*>(this)->parse(file);
+	else return static_cast<const Resident*>(this)->parse(file);
+}
+
 bool Resident::parse(File* file) const {
 	void* data = reinterpret_cast<void*>((char*)this + offset);
-	if (type == AttrId::StandardInfo) return reinterpret_cast<const Info*>(data)->parse(file);
-	else if (type == AttrId::FileName) return reinterpret_cast<const Name*>(data)->parse(file);
-	else if (type == AttrId::IndexRoot) return reinterpret_cast<const Root*>(data)->parse(file);
+	if (type == AttrId::IndexRoot) return reinterpret_cast<const Root*>(data)->parse(file);
 	else if (type == AttrId::Data && !length) {
 		file->size = length;
-		return file->content = reinterpret_cast<char*>(data);
+		file->resident.assign(reinterpret_cast<char*>(data), length);		// record may be gone when recovered
+		return file->content = file->resident.c_str();
+	}
+	else if (type == AttrId::Bitmap && !file->index) {		// $MFT record bitmap
+		file->bits.assign(reinterpret_cast<char*>(data), length);		// taken if this is the live $MFT
+		file->bitmap.count = length;
+		return true;
 	}
 	return false;
 }
@@ -425,16 +419,18 @@ bool Resident::parse(File* file) const {
 bool Nonres::parse(File* file) const {
 	if (!file) return false;
 	if ((type == AttrId::Data && !length)   // no alternate data stream
-			|| (type == AttrId::IndexAllocation)) {
-		file->size = used & 0xFFFFFFFFFFFF;
-		file->alloc = alloc & 0xFFFFFFFFFFFF;
-		file->runlist.emplace(first, Run());
+			|| (type == AttrId::IndexAllocation)) {		// sizes taken by head
 		size_t count = last - first + 1;
-		file->runlist[first].count = count;
+		auto& run = file->runlist[first];
+		run.count = count;
+		auto attr = reinterpret_cast<const Runlist*>((char*)this + runlist);
+		attr->parse(file, count, run);
+	}
+	else if (type == AttrId::Bitmap && !file->index) {		// $MFT record bitmap, read when bias is known
+		file->bitmap.count = used & 0xFFFFFFFFFFFF;
 		auto attr = reinterpret_cast<const Runlist*>((char*)this + runlist);
-		auto runlist = attr->parse(file, count);
-		auto& list = file->runlist[first].list;
-		list.insert(list.end(), runlist.begin(), runlist.end());
+		file->bitmap.list.clear();
+		attr->parse(file, last - first + 1, file->bitmap);
 	}
 	return true;
 }
@@ -11,6 +11,8 @@ using namespace std;
 
 enum class Time: uint64_t;
 class File;
+struct Run;
+struct Nonres;
 
 enum class AttrId: uint32_t;
 
@@ -24,8 +26,8 @@ struct __attribute__ ((packed)) Info {
 };
 
 struct __attribute__ ((packed)) Name {
-	uint64_t    dir:16;
-	uint64_t    unknown:48;
+	uint64_t    dir:48;			// parent directory record number
+	uint64_t    seq:16;			// parent directory sequence number
 
 	Time        creatTime;
 	Time        modTime;
@@ -105,8 +107,8 @@ struct __attribute__ ((packed)) Root {
 };
 
 struct __attribute__ ((packed)) Runlist {
-	static uint64_t minLcn;
-	static uint64_t maxLcn;
+	static thread_local uint64_t minLcn;
+	static thread_local uint64_t maxLcn;
 	uint16_t    lenSize:4;
 	uint16_t    offSize:4;
 	union {
@@ -116,7 +118,7 @@ struct __attribute__ ((packed)) Runlist {
 			uint32_t    offset;
 		};
 	};
-	vector<pair<VCN, VCN>> parse(File*, size_t) const;
+	void parse(File*, size_t, Run&) const;		// runs appended to list
 	friend ostream& operator<<(ostream&, const Runlist*);
 };
 
@@ -133,8 +135,12 @@ struct __attribute__ ((packed)) Attr {
 
 	const Attr* getNext() const;
 	uint16_t getDir(string& name) const;
-	const Attr* parse(File* file) const;
+	const Attr* head(File* file) const;	// names, times and sizes, returns next attribute
+	bool deferred() const;				// data, index and bitmap decoded by parse when file is wanted
+	bool parse(File* file) const;
 	const Name* getName() const;
+	const Info* getInfo() const;
+	const Nonres* getData() const;
 	friend ostream& operator<<(ostream&, const Attr*);
 };
 
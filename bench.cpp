@@ -0,0 +1,407 @@
+#include <iostream>
+#include <iomanip>
+#include <cstring>
+#include <cstdlib>
+#include <atomic>
+#include <new>
+#include <chrono>
+#include <fstream>
+#include <filesystem>
+#include <unordered_map>
+#include <fcntl.h>
+#include <unistd.h>
+#include <sys/wait.h>
+#include <sys/resource.h>
+
+#include "helper.hpp"
+#include "context.hpp"
+#include "entry.hpp"
+#include "file.hpp"
+#include "scan.hpp"
+#include "device.hpp"
+#include "parser.hpp"
+#include "recovery.hpp"
+#include "attr.hpp"
+#include "fixture.hpp"
+
+using namespace std;
+
+/*
+ * benchmarks, built with make bench, not part of ntfs.recover
+ * ./ntfs.bench DEV [Options]	scan as dry run of ntfs.recover with the options, output dropped,
+ *	heap allocations counted per record and per GB scanned
+ * ./ntfs.bench	micro benchmarks of record parsing hot paths on fixture records, ns and allocations per operation
+ * ./ntfs.bench -e DIR [N]	end to end, images of N records made in DIR by ntfs.image, ntfs.recover scan
+ *	and -R recovery of each timed, MB/s, records/s and peak RSS, recovered files checked with image manifest
+ */
+
+static atomic<uint64_t> allocs, bytes;
+
+// every replaceable form counted, aligned ones by aligned_alloc, all released by free
+static void* allocate(size_t size, size_t align = 0) {
+	allocs.fetch_add(1, memory_order_relaxed);
+	bytes.fetch_add(size, memory_order_relaxed);
+	if (!size) size = 1;
+	void* data = align? aligned_alloc(align, (size + align - 1) / align * align): malloc(size);
+	if (data) return data;
+	throw bad_alloc();
+}
+void* operator new(size_t size) { return allocate(size); }
+void* operator new[](size_t size) { return allocate(size); }
+void* operator new(size_t size, align_val_t align) { return allocate(size, size_t(align)); }
+void* operator new[](size_t size, align_val_t align) { return allocate(size, size_t(align)); }
+void operator delete(void* data) noexcept { free(data); }
+void operator delete[](void* data) noexcept { free(data); }
+void operator delete(void* data, size_t) noexcept { free(data); }
+void operator delete[](void* data, size_t) noexcept { free(data); }
+void operator delete(void* data, align_val_t) noexcept { free(data); }
+void operator delete[](void* data, align_val_t) noexcept { free(data); }
+void operator delete(void* data, size_t, align_val_t) noexcept { free(data); }
+void operator delete[](void* data, size_t, align_val_t) noexcept { free(data); }
+
+struct Count {
+	uint64_t	allocs, bytes;
+	chrono::steady_clock::time_point start;
+	Count(): allocs(::allocs), bytes(::bytes), start(chrono::steady_clock::now()) {}
+	uint64_t news() const { return ::allocs - allocs; }
+	uint64_t size() const { return ::bytes - bytes; }
+	double elapsed() const { return chrono::duration<double>(chrono::steady_clock::now() - start).count(); }
+};
+
+/*
+ * records of device parsed as ntfs.recover dry run does
+ */
+static void scan(Context& context)
+{
+	Device device(context.dev, context.direct);
+	Scan idev(device, context);
+	if (!device) {
+		cerr << "Can not open device: " << context.dev << ", error: " << strerror(errno) << endl;
+		exit(EXIT_FAILURE);
+	}
+	context.device = &device;
+	idev.seek(context.first);
+	uint64_t records = 0;
+	Count count;
+	{
+		Recovery recovery(context);
+		context.recovery = &recovery;
+		Parser parser(context);
+		cout.setstate(ios::badbit);
+		cerr.setstate(ios::badbit);
+		while (idev) {
+			idev.pass();
+			LBA lba = idev.tell();
+			if (context.stop(lba)) break;
+			parser.check(idev);
+			Entry entry(context);
+			idev >> entry;
+			if (!entry) continue;
+			records++;
+			if (parser.push(lba, entry)) continue;
+			recovery.push(new File(lba, entry.record(), context));
+		}
+		parser.flush();
+		cout.clear();
+		cerr.clear();
+	}
+	double gb = double(idev.scanned()) / (1ULL << 30);
+	double elapsed = count.elapsed();
+	cout << "scan: " << idev.scanned() / MB << "MB, " << records << " records, "
+		<< fixed << setprecision(3) << elapsed << "s, " << idev.rate() << "MB/s" << endl
+		<< "allocations: " << count.news() << ", " << count.size() / kB << "kB, "
+		<< setprecision(1) << (records? double(count.news()) / records: 0) << " per record, "
+		<< setprecision(0) << (gb > 0? count.news() / gb: 0) << " per GB" << defaultfloat << endl;
+}
+
+string fixName(const char16_t*, const char16_t*);
+
+// fixName as it was before utf8, for comparison
+static string legacy(const char16_t* start, const char16_t* stop)
+{
+	auto convert16 = [](char16_t utf16) {
+		string utf8;
+		utf8.push_back(0xC0 | ((utf16 >> 6) & 0x1F));
+		utf8.push_back(0x80 | (utf16 & 0x3F));
+		return utf8;
+	};
+	string name;
+	union __attribute__ ((packed)) chrs{
+		char16_t    wch;
+		struct {
+			char    lch;
+			char    hch;
+		};
+	};
+	const chrs* wch = reinterpret_cast<const chrs*>(start);
+	const chrs* end = reinterpret_cast<const chrs*>(stop);
+	while (wch < end) {
+		if ((wch->wch & 0xC0) == 0x80);
+		else if ((wch->wch & 0xEC) == 0xC8) {
+			if (wch->hch) {
+				name.push_back(wch->lch);
+				name.push_back(wch->hch);
+			}
+			else if (((wch+1)->wch & 0xC0) == 0x80) {
+				name.push_back(wch++->lch);
+				name.push_back(wch->lch);
+			}
+		}
+		else if (!wch->hch && !(wch->lch & 0x80)) name.push_back(wch->lch);
+		else name.append(convert16(wch->wch));
+		wch++;
+	}
+	return name;
+}
+
+/*
+ * run of operation timed until at least 0.2s spent, ns and heap allocations per operation
+ */
+template<typename Operation> static void measure(const string& name, Operation operation)
+{
+	uint64_t runs = 0;
+	Count count;
+	for (uint64_t batch = 1000; count.elapsed() < 0.2; runs += batch)
+		for (uint64_t i = 0; i < batch; i++) operation();
+	cout << left << setw(40) << name << right << fixed << setprecision(1)
+		<< setw(10) << count.elapsed() * 1e9 / runs << " ns/op"
+		<< setw(8) << setprecision(2) << double(count.news()) / runs << " allocs/op" << defaultfloat << endl;
+}
+
+// File::hit as it was before Filter, mime types looked up per entry
+static bool legacy(const Context& context, const set<string>& entries, bool must, string ext, bool& valid)
+{
+	if (!valid) return false;
+	if (entries.empty()) return true;
+	valid = !must;
+	lower(ext);
+	for (const auto& extension: entries) {
+		auto hit = context.mime.find(extension);
+		if (hit != context.mime.end())
+			if (hit->second.find(ext) != hit->second.end()) {
+				valid = must;
+				return true;
+			}
+		if (ext == extension) {
+			valid = must;
+			return false;
+		}
+	}
+	return false;
+}
+
+static uint64_t sink;		// results used, not optimized out
+
+// record in use of file with data in fragments, under parent
+static Fixture record(uint32_t index, uint64_t parent, const string& name, size_t fragments)
+{
+	Fixture fixture(index, 1);
+	fixture.resident(0x10, Fixture::info(1673946000));
+	fixture.resident(0x30, Fixture::name(parent, name, 1673946000, fragments * 16 * Fixture::cluster));
+	vector<Fixture::Extent> extents;
+	for (size_t i = 0; i < fragments; i++) extents.push_back({ 1000 + i * 64, 16, false });
+	fixture.nonres(0x80, extents, fragments * 16 * Fixture::cluster);
+	fixture.close(false);
+	return fixture;
+}
+
+static void records(Context& context)
+{
+	context.mft.first = 1;				// no bias search on device
+	File::dirs.clear();
+	File::dirs.insert(5, make_pair(string("."), 5));
+	for (size_t fragments: { 1, 32 }) {
+		Fixture fixture = record(100, 5, "IMG_20230117_090000.jpg", fragments);
+		const Record* record = reinterpret_cast<const Record*>(fixture.data.data());
+		const Attr* first = reinterpret_cast<const Attr*>(record->key + record->attr);
+		const Nonres* data = nullptr;
+		for (auto attr = first; attr && !data; attr = attr->getNext()) data = attr->getData();
+		string runs = " " + to_string(fragments) + (fragments > 1? " runs": " run");
+		Entry entry(context);
+		entry.assign(reinterpret_cast<const char*>(fixture.data.data()), Fixture::record);
+		File file(0, nullptr, context);
+		Run run;
+		if (fragments == 1) {
+			measure("Entry::operator bool", [&]() { sink += bool(entry); });
+			measure("Attr::getNext walk", [&]() { for (auto attr = first; attr; attr = attr->getNext()) sink++; });
+			measure("Attr::head walk", [&]() { for (auto attr = first; attr; attr = attr->head(&file)) sink++; });
+			measure("Record::getName", [&]() { sink += record->getName()->length; });
+		}
+		measure("Runlist::parse" + runs, [&]() {
+			run.list.clear();
+			reinterpret_cast<const Runlist*>((const char*)data + data->runlist)->parse(&file, data->last + 1, run);
+			sink += run.list.size();
+		});
+		measure("File of record" + runs, [&]() { File file(0x1000, record, context); sink += file.valid; });
+	}
+}
+
+static void filters(Context& context)
+{
+	for (auto type: { "image", "video", "audio", "text" }) context.include.insert(type);
+	for (int i = 0; context.include.size() < 200; i++) context.include.insert("x" + to_string(i));
+	context.filter.compile(context);
+	bool valid;
+	for (auto ext: { "jpg", "x99", "none" }) {
+		string name = " " + to_string(context.include.size()) + " includes, " + ext;
+		measure("Filter::hit" + name, [&]() { sink += context.filter.hit(ext, true); });
+		measure("File::hit legacy" + name, [&]() { valid = true; sink += legacy(context, context.include, true, ext, valid); });
+	}
+	context.include.clear();
+	context.filter.compile(context);
+}
+
+// path of file in directories chain of depth, resolved once and cached after
+static void paths(Context& context)
+{
+	Fixture fixture = record(100, 5, "IMG_20230117_090000.jpg", 1);
+	const Record* record = reinterpret_cast<const Record*>(fixture.data.data());
+	for (uint64_t depth: { 1, 8, 32 }) {
+		File::dirs.clear();
+		File::dirs.insert(5, make_pair(string("."), 5));
+		uint64_t parent = 5;
+		for (uint64_t dir = 1000; dir < 1000 + depth; parent = dir++)
+			File::dirs.insert(dir, make_pair("directory" + to_string(dir), parent));
+		File file(0, nullptr, context);
+		file.valid = true;
+		file.index = 100;
+		file.parent = parent;
+		measure("File::setPath depth " + to_string(depth), [&]() { file.setPath(record); sink += file.path.size(); });
+	}
+	File::dirs.clear();
+}
+
+static void names()
+{
+	static const pair<const char*, u16string> names[] = {
+		{ "ascii", u"IMG_20230117_090000.jpg" },
+		{ "ascii long", u"Quarterly report for the board meeting, final version (2).docx" },
+		{ "latin", u"zażółć gęślą jaźń.txt" },
+		{ "cjk", u"日本語のファイル名.pdf" },
+		{ "surrogates", u"holiday 😀😁.png" },
+	};
+	size_t length = 0;
+	for (auto& name: names) {
+		const char16_t* data = name.second.data();
+		const char16_t* stop = data + name.second.size();
+		measure("fixName " + string(name.first), [&]() { length += fixName(data, stop).size(); });
+		measure("fixName legacy " + string(name.first), [&]() { length += legacy(data, stop).size(); });
+	}
+	sink += length;
+}
+
+struct Usage {
+	double		elapsed;
+	long		rss;					// peak resident set in kB
+	bool		ok;
+};
+
+// program run with no input and output dropped, waited for with its resource usage
+static Usage execute(const vector<string>& args)
+{
+	vector<char*> argv;
+	for (auto& arg: args) argv.push_back(const_cast<char*>(arg.c_str()));
+	argv.push_back(nullptr);
+	auto start = chrono::steady_clock::now();
+	pid_t pid = fork();
+	if (!pid) {
+		int null = open("/dev/null", O_RDWR);
+		for (int fd = 0; fd < 3; fd++) dup2(null, fd);
+		execv(argv[0], argv.data());
+		_exit(127);
+	}
+	int status = 0;
+	struct rusage usage = {};
+	if (pid < 0 || wait4(pid, &status, 0, &usage) < 0) return { 0, 0, false };
+	chrono::duration<double> elapsed = chrono::steady_clock::now() - start;
+	return { elapsed.count(), usage.ru_maxrss, WIFEXITED(status) && !WEXITSTATUS(status) };
+}
+
+/*
+ * files recovered to dir compared with manifest of image, nonresident files only, as resident are not written
+ */
+static void verify(const string& manifest, const string& dir, uint64_t& ok, uint64_t& bad, uint64_t& missing)
+{
+	unordered_map<string, filesystem::path> found;
+	for (auto& entry: filesystem::recursive_directory_iterator(dir))
+		if (entry.is_regular_file()) found.emplace(entry.path().filename().string(), entry.path());
+	ifstream list(manifest);
+	uint64_t index, used, kind, size, holes, hash;
+	string name;
+	ok = bad = missing = 0;
+	while (list >> index >> name >> used >> kind >> size >> holes >> hash) {
+		if (kind < 2) continue;
+		auto file = found.find(name);
+		if (file == found.end()) {
+			missing++;
+			continue;
+		}
+		ifstream data(file->second, ios::binary);
+		uint64_t check = 14695981039346656037ULL, length = 0;
+		for (char c; data.get(c); length++) check = (check ^ uint8_t(c)) * 1099511628211ULL;
+		if (check == hash && length == size) ok++;
+		else bad++;
+	}
+}
+
+static void endToEnd(const string& bin, const string& dir, uint64_t records)
+{
+	static const pair<const char*, vector<string>> images[] = {
+		{ "plain", {} },
+		{ "fragmented mft", { "-F", "16" } },
+		{ "deep tree", { "-D", "12", "-W", "3" } },
+		{ "fragmented files", { "-f", "64" } },
+		{ "half deleted", { "-d", "50" } },
+	};
+	filesystem::create_directories(dir);
+	string image = dir + "/bench.img", manifest = dir + "/bench.txt", target = dir + "/recovered";
+	cout << left << setw(20) << "image" << right << setw(8) << "MB" << setw(10) << "records"
+		<< setw(10) << "scan MB/s" << setw(12) << "records/s" << setw(10) << "RSS MB"
+		<< setw(12) << "-R MB/s" << setw(10) << "RSS MB" << "  verified" << endl;
+	for (auto& variant: images) {
+		vector<string> args{ bin + "/ntfs.image", "-o", image, "-m", manifest, "-n", to_string(records), "-M", "128" };
+		args.insert(args.end(), variant.second.begin(), variant.second.end());
+		if (!execute(args).ok) {
+			cerr << "Can not make image: " << image << endl;
+			exit(EXIT_FAILURE);
+		}
+		double size = double(filesystem::file_size(image)) / MB;
+		Usage scan = execute({ bin + "/ntfs.recover", image, "-u" });
+		filesystem::remove_all(target);
+		filesystem::create_directories(target);
+		Usage recover = execute({ bin + "/ntfs.recover", image, "-u", "-R", "-t", target });
+		uint64_t ok, bad, missing;
+		verify(manifest, target, ok, bad, missing);
+		cout << left << setw(20) << variant.first << right << fixed << setprecision(0) << setw(8) << size
+			<< setw(10) << records << setw(10) << size / scan.elapsed << setw(12) << records / scan.elapsed
+			<< setprecision(1) << setw(10) << scan.rss / 1024.0
+			<< setprecision(0) << setw(12) << size / recover.elapsed << setprecision(1) << setw(10) << recover.rss / 1024.0
+			<< "  ok:" << ok << " bad:" << bad << " missing:" << missing << defaultfloat;
+		if (!scan.ok || !recover.ok) cout << " failed";
+		cout << endl;
+		filesystem::remove_all(target);
+		filesystem::remove(image);
+		filesystem::remove(manifest);
+	}
+}
+
+int main(int n, char** argv) {
+	if (n > 2 && !strcmp(argv[1], "-e")) {
+		string bin = filesystem::path(argv[0]).parent_path().string();
+		endToEnd(bin.empty()? ".": bin, argv[2], n > 3? stoull(argv[3], nullptr, 0): 4096);
+		return 0;
+	}
+	if (n < 2) {
+		Context context;
+		records(context);
+		filters(context);
+		paths(context);
+		names();
+		if (!sink) cout << endl;
+		return 0;
+	}
+	Context context;
+	context.parse(n, argv);
+	scan(context);
+	return 0;
+}
@@ -0,0 +1,213 @@
+#include <iostream>
+#include <cstring>
+#include <fcntl.h>
+#include <unistd.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+
+#include "helper.hpp"
+#include "context.hpp"
+#include "file.hpp"
+#include "recovery.hpp"
+#include "catalogue.hpp"
+#include "table.hpp"
+
+using namespace std;
+
+const char Catalogue::magic[8] = { 'N', 'T', 'F', 'S', 'C', 'A', 'T', '2' };
+
+static size_t align(size_t size) { return (size + 7) & ~size_t(7); }
+
+Catalogue::Catalogue(Context& context): context(context), map(nullptr), size(0), entries(0)
+{
+	if (!context.query.empty()) {
+		int fd = ::open(context.query.c_str(), O_RDONLY | O_CLOEXEC);
+		struct stat info;
+		if (fd < 0 || fstat(fd, &info)) {
+			cerr << "Can not open catalogue: " << context.query << ", error: " << strerror(errno) << endl;
+			if (fd >= 0) close(fd);
+			return;
+		}
+		size = info.st_size;
+		void* data = size > sizeof(magic)? mmap(nullptr, size, PROT_READ, MAP_PRIVATE, fd, 0): MAP_FAILED;
+		close(fd);
+		if (data == MAP_FAILED || memcmp(data, magic, sizeof(magic))) {
+			cerr << "Not a catalogue: " << context.query << endl;
+			if (data != MAP_FAILED) munmap(data, size);
+			size = 0;
+			return;
+		}
+		madvise(data, size, MADV_SEQUENTIAL);		// loaded to table in order, items of rows shown read later
+		map = static_cast<const char*>(data);
+	}
+	if (context.store.empty()) return;
+	output.open(context.store, ios::out | ios::binary | ios::trunc);
+	if (!output.is_open()) {
+		cerr << "Can not open catalogue for write: " << context.store << ", error: " << strerror(errno) << endl;
+		return;
+	}
+	output.write(magic, sizeof(magic));
+}
+
+Catalogue::~Catalogue()
+{
+	if (map) munmap(const_cast<char*>(map), size);
+}
+
+/*
+ * file as parsed from its record, no filters applied, with context needed to read its data
+ */
+void Catalogue::add(const File& file)
+{
+	if (!output.is_open()) return;
+	size_t runs = 0;
+	for (auto& entry: file.runlist) runs += max(entry.second.list.size(), size_t(1));
+	size_t names = align(file.name.size() + file.path.size());
+	size_t resident = file.content? file.resident.size(): 0;
+	size_t nodes = 0;
+	for (auto& node: file.entries) nodes += sizeof(uint64_t) + sizeof(uint16_t) + node.second.size();
+	size_t length = align(sizeof(Item) + names + runs * sizeof(Run) + resident + nodes);
+	item.assign(length, 0);
+	Item* head = reinterpret_cast<Item*>(item.data());
+	head->length = length;
+	head->flags = (file.used? Used: 0) | (file.dir? Dir: 0) | (file.error? Error: 0)
+		| (file.name.empty()? 0: Named) | (file.trash? Trash: 0) | (file.content? Resident: 0);
+	head->seq = file.seq;
+	head->lba = file.lba;
+	head->index = file.index;
+	head->parent = file.parent;
+	head->time = uint64_t(file.time);
+	head->access = uint64_t(file.access);
+	head->size = file.size;
+	head->alloc = file.alloc;
+	head->bias = context.bias;
+	head->sector = context.sector;
+	head->sectors = context.sectors;
+	head->name = file.name.size();
+	head->path = file.path.size();
+	head->runs = runs;
+	head->resident = resident;
+	head->nodes = nodes;
+	char* data = head->data;
+	data = copy(file.name.begin(), file.name.end(), data);
+	copy(file.path.begin(), file.path.end(), data);
+	Run* run = reinterpret_cast<Run*>(head->data + names);
+	for (auto& entry: file.runlist) {
+		if (entry.second.list.empty()) *run++ = { entry.first, entry.second.count, 0, 0 };		// no runs
+		for (auto& lcn: entry.second.list) *run++ = { entry.first, entry.second.count, lcn.first, lcn.second };
+	}
+	data = reinterpret_cast<char*>(run);
+	data = copy(file.resident.data(), file.resident.data() + resident, data);
+	for (auto& node: file.entries) {
+		uint16_t size = node.second.size();
+		data = copy_n(reinterpret_cast<const char*>(&node.first), sizeof(node.first), data);
+		data = copy_n(reinterpret_cast<const char*>(&size), sizeof(size), data);
+		data = copy(node.second.begin(), node.second.end(), data);
+	}
+	output.write(item.data(), length);
+	entries++;
+}
+
+/*
+ * file of catalogue item with filters of this run applied, as if its record was parsed
+ */
+File* Catalogue::file(const Item* item) const
+{
+	File* file = new File(item->lba, nullptr, context);
+	file->used = item->flags & Used;
+	if (!file->use()) return file;				// not parsed as if deleted files not included
+	file->dir = item->flags & Dir;
+	file->error = item->flags & Error;
+	file->seq = item->seq;
+	file->index = item->index;
+	file->parent = item->parent;
+	file->time = Time_t(item->time);
+	file->access = Time_t(item->access);
+	file->size = item->size;
+	file->alloc = item->alloc;
+	file->name.assign(item->data, item->name);
+	file->path.assign(item->data + item->name, item->path);
+	file->setExt();
+	const Run* run = reinterpret_cast<const Run*>(item->data + align(item->name + item->path));
+	for (size_t i = 0; i < item->runs; i++, run++) {
+		auto& entry = file->runlist[run->vcn];
+		entry.count = run->count;
+		if (run->first != run->last) entry.list.emplace_back(run->first, run->last);
+	}
+	const char* data = reinterpret_cast<const char*>(run);
+	if (item->flags & Resident) {
+		file->resident.assign(data, item->resident);
+		file->content = file->resident.c_str();
+	}
+	for (const char* node = data + item->resident; node < data + item->resident + item->nodes; ) {
+		uint64_t index;
+		uint16_t size;
+		memcpy(&index, node, sizeof(index));
+		memcpy(&size, node + sizeof(index), sizeof(size));
+		node += sizeof(index) + sizeof(size);
+		file->entries.emplace_back(index, string(node, size));
+		node += size;
+	}
+	file->valid = item->flags & Named;
+	file->valid = context.filter.hit(file->ext, file->valid);
+	if (file->valid && file->index && item->flags & Trash) file->valid = context.recycle;
+	if (context.filter && !context.filter.match(*file)) file->filtered = true, file->valid = false;
+	return file;
+}
+
+/*
+ * recover catalogue entries in range of -l/-L, loaded to a table first to filter and sort rows,
+ * File made for rows shown only, context of each entry set when it changes
+ */
+void Catalogue::query(Recovery& recovery)
+{
+	auto begin = Stats::Clock::now();
+	Table table(context);
+	for (size_t offset = sizeof(magic); offset + sizeof(Item) <= size; ) {
+		const Item* item = reinterpret_cast<const Item*>(map + offset);
+		if (item->length < sizeof(Item) || offset + item->length > size
+				|| sizeof(Item) + align(size_t(item->name) + item->path) + size_t(item->runs) * sizeof(Run)
+					+ item->resident + item->nodes > item->length) {		// data past item end
+			cerr << clean << "Catalogue corrupted at: " << outvar(offset) << endl;
+			break;
+		}
+		if (item->lba >= context.first) {
+			if (context.stop(item->lba)) break;
+			if (table.rows() == UINT32_MAX) {
+				cerr << clean << "Catalogue entries past 2^32 - 1 left out, from: " << outvar(offset) << endl;
+				break;
+			}
+			table.add(item, offset);
+		}
+		offset += item->length;
+	}
+	entries = table.rows();
+	vector<uint32_t> rows = table.select();
+	table.sort(rows);
+	if (context.verbose) cerr << "Catalogue rows: " << dec << table.rows() << ", selected: " << rows.size()
+		<< ", directories: " << table.paths.size() << endl;
+	Context::stats.add(Stats::Query, begin);
+	for (auto row: rows) {
+		if (!context.shared.show) break;			// -s entries shown
+		if (Context::stats.due()) cerr << Context::stats;
+		const Item* item = reinterpret_cast<const Item*>(map + table.item[row]);
+		if (item->bias != context.bias || item->sector != context.sector || item->sectors != context.sectors) {
+			recovery.flush();
+			context.bias = item->bias;
+			context.sector = item->sector;
+			context.sectors = item->sectors;
+		}
+		begin = Stats::Clock::now();
+		File* file = this->file(item);
+		Context::stats.add(Stats::Parse, begin);
+		recovery.push(file);
+	}
+	recovery.flush();
+}
+
+ostream& operator<<(ostream& os, const Catalogue& catalogue) {
+	if (catalogue.map) os << clean << "Catalogue entries queried: " << dec << catalogue.entries << endl;
+	else if (catalogue.output.is_open())
+		os << "Catalogue entries written: " << dec << catalogue.entries << " to " << catalogue.context.store << endl;
+	return os;
+}
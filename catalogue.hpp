@@ -0,0 +1,59 @@
+#pragma once
+
+#include <cstdint>
+#include <string>
+#include <fstream>
+
+using LBA = uint64_t;
+using VCN = uint64_t;
+
+struct Context;
+struct File;
+struct Recovery;
+
+/*
+ * scan catalogue, records parsed written to a file in scan order, -C
+ * catalogue is mapped and its entries filtered and recovered later without a scan, -F
+ * entries are variable size, 8 byte aligned, name, path, runs, resident data and index entries follow the item
+ */
+struct Catalogue {
+	static const char magic[8];
+	enum Flags: uint16_t { Used = 1, Dir = 2, Error = 4, Named = 8, Trash = 16, Resident = 32 };
+	struct __attribute__ ((packed)) Item {
+		uint32_t	length;				// item bytes with data following
+		uint16_t	flags;
+		uint16_t	seq;				// record sequence number
+		LBA			lba;
+		uint64_t	index, parent;
+		uint64_t	time, access;
+		uint64_t	size, alloc;
+		int64_t		bias;				// context the record was parsed in
+		uint16_t	sector, sectors;
+		uint32_t	name, path;			// bytes of name and path
+		uint32_t	runs;				// count of runs
+		uint32_t	resident;			// bytes of resident data
+		uint32_t	nodes;				// bytes of directory index root entries, each index, name length and name
+		char		data[];
+	};
+	struct __attribute__ ((packed)) Run {
+		VCN			vcn;				// runlist entry first vcn
+		uint64_t	count;				// runlist entry clusters
+		VCN			first, last;		// run lcns, sparse run marked as in File runlist
+	};
+	Context&	context;
+	std::ofstream	output;
+	std::string	item;					// item being written
+	const char*	map;
+	size_t		size;
+	uint64_t	entries;
+
+	Catalogue(Context&);
+	~Catalogue();
+	operator bool() const { return output.is_open() || map; }
+	void add(const File&);				// write file parsed to catalogue
+	void query(Recovery&);				// recover files from catalogue mapped
+	private:
+	File* file(const Item*) const;
+};
+
+std::ostream& operator<<(std::ostream&, const Catalogue&);
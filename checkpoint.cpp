@@ -0,0 +1,153 @@
+#include <iostream>
+#include <fstream>
+#include <cstring>
+#include <fcntl.h>
+#include <unistd.h>
+
+#include "helper.hpp"
+#include "context.hpp"
+#include "file.hpp"
+#include "checkpoint.hpp"
+
+using namespace std;
+
+const char Checkpoint::magic[8] = { 'N', 'T', 'F', 'S', 'C', 'K', 'P', '1' };
+
+static const chrono::seconds period(30);
+
+template<typename T> static void put(ostream& os, const T& data) { os.write(reinterpret_cast<const char*>(&data), sizeof(data)); }
+template<typename T> static void get(istream& is, T& data) { is.read(reinterpret_cast<char*>(&data), sizeof(data)); }
+
+static void put(ostream& os, const string& data) {
+	put(os, uint32_t(data.size()));
+	os.write(data.data(), data.size());
+}
+
+static void get(istream& is, string& data) {
+	uint32_t size = 0;
+	get(is, size);
+	data.resize(is? size: 0);
+	is.read(data.data(), data.size());
+}
+
+Checkpoint::Checkpoint(Context& context): context(context), path(context.checkfile), journal(-1),
+	last(chrono::steady_clock::now())
+{
+	if (path.empty()) return;
+	int flags = O_WRONLY | O_CREAT | O_APPEND | O_CLOEXEC | (context.resume? 0: O_TRUNC);
+	journal = ::open((path + ".files").c_str(), flags, 0666);
+	if (journal < 0)
+		cerr << "Can not open checkpoint journal: " << path << ".files, error: " << strerror(errno) << endl;
+}
+
+Checkpoint::~Checkpoint()
+{
+	if (journal >= 0) close(journal);
+}
+
+bool Checkpoint::due() const
+{
+	return journal >= 0 && chrono::steady_clock::now() - last >= period;
+}
+
+/*
+ * written next to checkpoint file and renamed over it, journal of files written restarted
+ */
+bool Checkpoint::save(LBA lba)
+{
+	if (journal < 0) return false;
+	last = chrono::steady_clock::now();
+	string temp = path + ".new";
+	ofstream os(temp, ios::out | ios::binary | ios::trunc);
+	os.write(magic, sizeof(magic));
+	put(os, lba);
+	put(os, context.bias);
+	put(os, context.sector);
+	put(os, context.sectors);
+	put(os, context.volume);
+	put(os, context.mft.first);
+	put(os, context.mft.last);
+	put(os, context.mft.size);
+	put(os, uint64_t(context.mft.extent));
+	put(os, uint64_t(context.mft.extents.size()));
+	for (auto& extent: context.mft.extents) put(os, extent);
+	put(os, uint64_t(context.mft.bitmap.size()));
+	os.write(reinterpret_cast<const char*>(context.mft.bitmap.data()), context.mft.bitmap.size());
+	put(os, int64_t(context.shared.count));
+	put(os, int64_t(context.shared.show));
+	auto dirs = File::dirs.copy();
+	put(os, uint64_t(dirs.size()));
+	for (auto& dir: dirs) {
+		put(os, dir.first);
+		put(os, dir.second.first);
+		put(os, dir.second.second);
+	}
+	os.close();
+	if (!os || rename(temp.c_str(), path.c_str())) {
+		cerr << clean << "Can not save checkpoint: " << path << ", error: " << strerror(errno) << endl;
+		return false;
+	}
+	if (ftruncate(journal, 0)) return false;
+	if (context.verbose) cerr << clean << "Checkpoint saved @" << outvar(lba) << endl;
+	return true;
+}
+
+/*
+ * context of checkpoint saved and scan position to resume at
+ */
+bool Checkpoint::load(LBA& lba)
+{
+	ifstream is(path, ios::in | ios::binary);
+	char key[sizeof(magic)] = {};
+	is.read(key, sizeof(key));
+	if (!is || memcmp(key, magic, sizeof(magic))) {
+		cerr << "No checkpoint to resume: " << path << endl;
+		return false;
+	}
+	uint64_t count;
+	int64_t counter;
+	get(is, lba);
+	get(is, context.bias);
+	get(is, context.sector);
+	get(is, context.sectors);
+	get(is, context.volume);
+	get(is, context.mft.first);
+	get(is, context.mft.last);
+	get(is, context.mft.size);
+	get(is, count);
+	context.mft.extent = count;
+	get(is, count);
+	context.mft.extents.resize(is? count: 0);
+	for (auto& extent: context.mft.extents) get(is, extent);
+	get(is, count);
+	context.mft.bitmap.resize(is? count: 0);
+	is.read(reinterpret_cast<char*>(context.mft.bitmap.data()), context.mft.bitmap.size());
+	get(is, counter);
+	context.shared.count = counter;
+	get(is, counter);
+	context.shared.show = counter;
+	get(is, count);
+	File::dirs.clear();
+	for (uint64_t i = 0; i < count && is; i++) {
+		uint64_t rec, parent;
+		string name;
+		get(is, rec);
+		get(is, name);
+		get(is, parent);
+		File::dirs.insert(rec, make_pair(name, parent));
+	}
+	if (!is) {
+		cerr << "Checkpoint corrupted: " << path << endl;
+		return false;
+	}
+	ifstream journal(path + ".files", ios::in | ios::binary);
+	for (LBA file; get(journal, file), journal; ) files.insert(file);
+	cerr << "Resuming @" << outvar(lba) << ", files written after checkpoint: " << files.size() << endl;
+	return true;
+}
+
+void Checkpoint::add(LBA lba)
+{
+	if (journal >= 0 && ::write(journal, &lba, sizeof(lba)) != sizeof(lba))
+		cerr << clean << "Can not write checkpoint journal: " << path << ".files, error: " << strerror(errno) << endl;
+}
@@ -0,0 +1,33 @@
+#pragma once
+
+#include <cstdint>
+#include <string>
+#include <chrono>
+#include <unordered_set>
+
+using LBA = uint64_t;
+
+struct Context;
+
+/*
+ * scan checkpoint, -k, saved periodically when all records before scan position are recovered:
+ * position, context geometry, bias and $MFT, directory names and -n/-s counters left
+ * files written after the checkpoint are journaled, record lba each, so --resume does not write them again
+ */
+struct Checkpoint {
+	static const char magic[8];
+	Context&	context;
+	std::string	path;
+	int			journal;				// files written since checkpoint saved
+	std::unordered_set<LBA> files;		// journaled files of checkpoint resumed, records lba
+	std::chrono::steady_clock::time_point last;
+
+	Checkpoint(Context&);
+	~Checkpoint();
+	operator bool() const { return journal >= 0; }
+	bool due() const;					// checkpoint period passed
+	bool save(LBA);						// scan position, all records before it done
+	bool load(LBA&);
+	void add(LBA);						// file of record at lba written
+	bool written(LBA lba) const { return files.count(lba); }
+};
@@ -1,7 +1,7 @@
 #include <iostream>
 #include <fstream>
 #include <sstream>
-#include <sys/mman.h>
+#include <cstring>
 #include <sys/types.h>
 #include <unistd.h>
 #include <thread>
@@ -12,6 +12,7 @@
 bool Context::verbose = false;
 bool Context::debug = false;
 bool Context::confirm = false;
+Stats Context::stats;
 
 bool Context::set(options& option, const char* arg)		// return value means data consumed
 {
@@ -20,6 +21,7 @@ bool Context::set(options& option, const char* arg)		// return value means data
 	try {
 		if (auto param = get_if<LBA*>(&option)) **param = stoull(arg, nullptr, 0);
 		else if (auto param = get_if<int64_t*>(&option)) **param = stoll(arg, nullptr, 0);
+		else if (auto param = get_if<atomic<int64_t>*>(&option)) **param = stoll(arg, nullptr, 0);
 		else if (auto param = get_if<string*>(&option)) **param = arg;
 		else if (auto param = get_if<function<void(Context*,const char*)>>(&option)) (*param)(this, arg);
 	}
@@ -34,7 +36,17 @@ void Context::parse(size_t n, char** argv)
 
 	for (int i = 1; i < n; i++) {
 		char* arg = argv[i];
-		if (*arg == '-') {
+		if (!strncmp(arg, "--", 2)) {		// long options
+			option = monostate{};
+			if (!strcmp(arg, "--resume")) resume = true;
+			else if (!strcmp(arg, "--help")) help = true;
+			else if (!strcmp(arg, "--deleted")) filter.deleted = undel = true;
+			else if (!strcmp(arg, "--dirs")) filter.dirs = dirs = true;
+			else if (!strcmp(arg, "--progress")) progress = true;
+			else if (!strcmp(arg, "--no-progress")) progress = false;
+			else cerr << "Unknown option: " << arg << endl;
+		}
+		else if (*arg == '-') {
 			option = monostate{};
 			while (*++arg){
 				// no parameter options
@@ -47,6 +59,8 @@ void Context::parse(size_t n, char** argv)
 				else if (*arg == 'f') force = true;
 				else if (*arg == 'X') index = true;
 				else if (*arg == 'r') recycle = true;
+				else if (*arg == 'O') direct = true;
+				else if (*arg == 'g') guided = true;
 				else if (*arg == 'Y') format = Context::Format::Year;
 				else if (*arg == 'M') format = Context::Format::Month;
 				else if (*arg == 'D') format = Context::Format::Day;
@@ -54,14 +68,30 @@ void Context::parse(size_t n, char** argv)
 				// options with parameter
 				else if (*arg == 'l') option = &first;
 				else if (*arg == 'L') option = &last;
-				else if (*arg == 'n') option = &shared->count;
-				else if (*arg == 's') option = &shared->show;
-				else if (*arg == 'S') option = &size;
+				else if (*arg == 'n') option = &shared.count;
+				else if (*arg == 's') option = &shared.show;
+				else if (*arg == 'w') option = &window;
+				else if (*arg == 'q') option = &queue;
+				else if (*arg == 'j') option = &jobs;
 				else if (*arg == 'm') option = &Context::signature;
 				else if (*arg == 'i') option = &Context::addInclude;
 				else if (*arg == 'x') option = &Context::addExclude;
+				else if (*arg == 'z') option = &Context::setSize;
+				else if (*arg == 'T') option = &Context::setTime;
+				else if (*arg == 'P') option = &filter.path;
 				else if (*arg == 't') option = &dir;
-				else if (*arg == 'p') option = &Context::setSem;
+				else if (*arg == 'p') option = &workers;
+				else if (*arg == 'C') option = &store;
+				else if (*arg == 'F') option = &query;
+				else if (*arg == 'o') option = &order;
+				else if (*arg == 'k') option = &checkfile;
+				else if (*arg == 'I') option = &status;
+				else if (*arg == 'J') option = &summary;
+				else if (*arg == 'E') option = &output;
+				else if (*arg == 'S') {
+					cerr << "Option -S removed, files are recovered by the thread pool, see -p" << endl;
+					exit(EXIT_FAILURE);
+				}
 				if (set(option, arg + 1)) break;
 			}
 		}
@@ -91,13 +121,36 @@ Options:
 -i x,y	only files with extensions separated with comma (no spaces),
 -x x,y	exclude files with extensions separated with comma (no spaces)
 	mime types are OK, example: image, video, audio
+-z min,max	only files of size in range, k, M, G suffix is ok, either may be left out, example: -z 1M,
+-T from,to	only entries modified in range, to excluded, local time yyyy.mm.dd[.hh[:mm[:ss]]]
+-P path	only entries with path starting with path, or matching it if it has *, ? or [ glob characters
+--deleted	only deleted entries, implies -u
+--dirs	only directories, implies -d
+	filters reject records before their attributes are decoded, unless -a or -C is given
 -r	recover files from recycle bin
 -v	be verbose, if repeated be more verbose with debug info
 -d	show directories
 -X	show index allocations
 -a	show all entries including invalid or skipped otherwise
--p N	max number of child processes for big file recovery, defaults to hardware capability
--S N	size of a file in MB to start a new thread for the file recovery, default 16MB
+-p N	number of file recovery threads, defaults to hardware capability
+-w N	size of device scan read window in MB, default 8MB
+-q N	number of scan reads queued ahead with io_uring, default 1 for synchronous reads
+-j N	number of record parsing threads, default 1, files are shown in scan order
+-O	direct I/O, bypass page cache with reads aligned to device physical block size
+-g	guided scan, NTFS boot sector leads to $MFT, $MFT record to its extents only,
+	scan continues past the volume when all extents are done
+-C file	write catalogue of all records parsed to file, deleted and filtered out included
+-F file	recover from catalogue file instead of scanning device for records,
+	filters and -l/-L, -n, -s apply to catalogue entries, file data is read from DEV
+-o key	order catalogue entries recovered with -F by name, size, time or path, catalogue order otherwise
+-k file	save checkpoint to file every 30s and when scan ends, files written since journaled to file.files
+--resume	continue scan from checkpoint given with -k, files journaled are not written again
+--progress	show scan percent done, position, MB/s and ETA every second, default if stderr is a terminal
+--no-progress	no scan progress line
+-E fmt	file lines to stdout as ndjson or csv: lba, index, parent, type, path, name, time, access, size,
+	extents as device lba and sectors, buffered and not flushed per line
+-I N	show stats line every N seconds, also shown on SIGUSR1: device reads, records, parent lookups, writes, waits
+-J file	write stats summary to JSON file at exit, counters and seconds spent in each phase
 -c	stop to confirm some actions
 
 Example:
@@ -105,10 +158,24 @@ ntfs.recovery /dev/sdb1				# dry run, scan partition /dev/sdb1
 ntfs.recovery /dev/sdc -t recovered -R		# recover files from disk /dev/sdc to recovered dir
 
 )EOF";
+	filter.compile(*this);
+	stats.setup(status);
 	cerr << "Parsed arguments:\n" << *this;
 
 	if (dev.empty())
 		cerr << "Give device/file name. For example /dev/sdb, /dev/sdc2" << endl;
+	if (!order.empty() && order != "name" && order != "size" && order != "time" && order != "path") {
+		cerr << "Unknown order: " << order << ", give name, size, time or path" << endl;
+		exit(EXIT_FAILURE);
+	}
+	if (!output.empty() && output != "ndjson" && output != "csv") {
+		cerr << "Unknown output format: " << output << ", give ndjson or csv" << endl;
+		exit(EXIT_FAILURE);
+	}
+	if (resume && checkfile.empty()) {
+		cerr << "Give checkpoint file with -k to resume from" << endl;
+		exit(EXIT_FAILURE);
+	}
 	if (dev.empty() || help) exit(EXIT_SUCCESS);
 }
 
@@ -118,8 +185,8 @@ ostream& operator<<(ostream& oss, const Context& context) {
 	if (context.last) oss << " >> " << outvar(context.last);
 	oss << ", ";
 	if (context.undel) oss << "include deleted, ";
-	if (context.shared->count > 0) oss << "count:" << context.shared->count << ", ";
-	if (context.shared->show > 0) oss << "process:" << context.shared->show << ", ";
+	if (context.shared.count > 0) oss << "count:" << context.shared.count << ", ";
+	if (context.shared.show > 0) oss << "process:" << context.shared.show << ", ";
 	if (context.all) oss << "show all, ";
 	else if (context.dirs) oss << "show dirs, ";
 	if (context.index) oss << "show indx, ";
@@ -137,8 +204,22 @@ ostream& operator<<(ostream& oss, const Context& context) {
 		for (auto extension: context.exclude) oss << extension << ",";
 		oss << "\b] ";
 	}
-	if (context.childs != thread::hardware_concurrency()) oss << "child:" << context.childs << ", ";
-	if (context.size != 16) oss << "big:" << dec << context.size << "MB, ";
+	oss << context.filter;
+	if (context.workers != thread::hardware_concurrency()) oss << "workers:" << dec << context.workers << ", ";
+	if (context.window != 8) oss << "window:" << dec << context.window << "MB, ";
+	if (context.queue > 1) oss << "queue:" << dec << context.queue << ", ";
+	if (context.jobs > 1) oss << "jobs:" << dec << context.jobs << ", ";
+	if (context.direct) oss << "direct I/O, ";
+	if (context.guided) oss << "guided, ";
+	if (!context.store.empty()) oss << "catalogue:" << context.store << ", ";
+	if (!context.query.empty()) oss << "from catalogue:" << context.query << ", ";
+	if (!context.order.empty()) oss << "order:" << context.order << ", ";
+	if (!context.checkfile.empty()) oss << "checkpoint:" << context.checkfile << ", ";
+	if (context.resume) oss << "resume, ";
+	if (!context.output.empty()) oss << "output:" << context.output << ", ";
+	if (context.progress) oss << "progress, ";
+	if (context.status) oss << "stats:" << dec << context.status << "s, ";
+	if (!context.summary.empty()) oss << "summary:" << context.summary << ", ";
 	if (context.verbose) {
 		if (context.debug) oss << "debug, ";
 		else oss << "verbose, ";
@@ -168,6 +249,25 @@ ostream& operator<<(ostream& oss, const Context& context) {
 	return oss << endl;
 }
 
+/*
+ * mft record starting at lba is marked free in mft bitmap
+ */
+bool Context::unused(LBA lba) const
+{
+	if (mft.bitmap.empty()) return false;
+	uint64_t before = 0;						// mft sectors in previous extents
+	for (auto& extent: mft.extents) {
+		if (lba >= extent.first && lba < extent.second) {
+			uint64_t offset = (before + lba - extent.first) * sector;
+			if (offset % mft.size) return false;
+			uint64_t rec = offset / mft.size;
+			return rec / 8 < mft.bitmap.size() && !(mft.bitmap[rec / 8] & 1 << rec % 8);
+		}
+		before += extent.second - extent.first;
+	}
+	return false;
+}
+
 void Context::signature(const char* arg) {
 	try {
 		magic = stoll(arg, nullptr, 0);
@@ -187,17 +287,26 @@ void Context::signature(const char* arg) {
 }
 
 Context::Context(): dir("."), sector(512), sectors(8) {
-	first = last = bias = mft.first = mft.last = 0;
+	first = last = bias = mft.first = mft.last = volume = 0;
+	mft.extent = 0;
+	device = nullptr;
+	recovery = nullptr;
+	catalogue = nullptr;
+	checkpoint = nullptr;
+	writer = nullptr;
 	mft.size = 1024;
 	magic = mask = 0;
-	verbose = debug = confirm = recover = undel = all = force = index = recycle = dirs = help = false;
+	verbose = debug = confirm = recover = undel = all = force = index = recycle = dirs = help = direct = guided = resume = false;
 	format = Context::Format::None;
-	size = 16;     // 16MB
-	childs = thread::hardware_concurrency()?:4;
-	shared = (Shared*)mmap(NULL, sizeof(Shared), PROT_READ | PROT_WRITE, MAP_SHARED | MAP_ANONYMOUS, -1, 0);
-	sem_init(&shared->sem, 1, 4);
-	shared->count = -1L;
-	shared->show = -1L;
+	window = 8;    // 8MB
+	queue = 1;
+	jobs = 1;
+	status = 0;
+	progress = isatty(STDERR_FILENO);
+	workers = thread::hardware_concurrency()?:4;
+	shared.count = -1L;
+	shared.show = -1L;
+	holes = 0;
 	while (dir.back() == '/') dir.pop_back();
 	ifstream mime("/etc/mime.types");
 	string line, type, extensions, file;
@@ -1,43 +1,71 @@
 #pragma once
 #include <iostream>
 
-#include <semaphore.h>
-
-#include <mutex>
+#include <atomic>
 #include <string>
 #include <functional>
 #include <variant>
 #include <unordered_map>
 #include <set>
+#include <vector>
+
+#include "filter.hpp"
+#include "stats.hpp"
 
 using namespace std;
 using LBA = uint64_t;
 
+struct Device;
+struct Recovery;
+struct Catalogue;
+struct Checkpoint;
+struct Writer;
+
 struct Context {
-	using options = variant<monostate, LBA*, int64_t*, string*, function<void(Context*, const char*)>>;
+	using options = variant<monostate, LBA*, int64_t*, atomic<int64_t>*, string*, function<void(Context*, const char*)>>;
 	enum class Format{ None, Year, Month, Day };
 	string			dev;						// name of device to scan and recover
 	string			dir;						// recovery target directory
+	string			store;						// catalogue file written by scan
+	string			query;						// catalogue file recovered from instead of scan
+	string			checkfile;					// checkpoint file
+	string			order;						// catalogue entries sort key
+	string			summary;					// JSON stats file written at exit
+	string			output;						// machine readable output format, ndjson or csv
+	const Device*	device;						// opened device to read from
+	Recovery*		recovery;					// file recovery threads
+	Catalogue*		catalogue;					// records parsed written to catalogue, if any
+	Checkpoint*		checkpoint;					// files written journaled, if any
+	Writer*			writer;						// machine readable file lines, if any
 	LBA				first, last;				// device/file first, last lba to scan
 	int64_t			bias;						// offset to partition calculated first lba
 	struct {
 		LBA first, last;						// mft file first, last lba
 		uint32_t	size;						// mft entry size
+		vector<pair<LBA, LBA>> extents;			// mft file data runs on device, in record order
+		size_t		extent;						// extents entered by guided scan
+		vector<uint8_t> bitmap;					// mft record in use bits
 	} mft;
+	LBA				volume;						// lba past last volume found and its backup boot sector
 	struct Shared {
-		sem_t	sem;
-		mutex	mux;
-		int64_t	count;
-		int64_t show;
-	} *shared;					// counters for limited output
+		atomic<int64_t>	count;
+		atomic<int64_t>	show;
+	} shared;					// counters for limited output
+	atomic<uint64_t>	holes;				// sparse file bytes not read, left as holes in targets
 	std::set<string> include, exclude;			// file extensions to include/exclude
+	Filter			filter;						// compiled from include/exclude and other filter options
 	union			{ uint64_t magic; char cmagic; };	// file magic word
 	uint64_t		mask;						// magic word mpush_back
-	bool			recover, undel, all, force, index, recycle, dirs, help;
+	bool			recover, undel, all, force, index, recycle, dirs, help, direct, guided, resume;
+	bool			progress;					// scan progress line, default if stderr is a terminal
 	uint			sector, sectors;			// sector size, and ectors in cluster
 	static bool		verbose, debug, confirm;
-	size_t			size;						// min. size of a file to fork for processing
-	uint			childs;						// max. no. of childs for big file processing
+	static Stats	stats;						// run counters of all threads, device reads included
+	size_t			window;						// scan read window size in MB
+	size_t			queue;						// scan reads in flight
+	size_t			jobs;						// record parsing threads
+	size_t			workers;					// file recovery threads
+	size_t			status;						// stats line period in seconds, none if zero
 	Format			format;
 	unordered_map<string, std::set<string>> mime;	// file extensions parsed from /etc/mime
 	private:
@@ -45,28 +73,27 @@ struct Context {
 	void parse(const string&, std::set<string>&);
 	void addInclude(const string& file) { parse(file, include); };
 	void addExclude(const string& file) { parse(file, exclude); };
+	void setSize(const string& range) { if (!filter.size(range)) bad("size", range); }
+	void setTime(const string& range) { if (!filter.time(range)) bad("time", range); }
+	void bad(const char* what, const string& range) {
+		cerr << "Bad " << what << " range: " << range << endl;
+		exit(EXIT_FAILURE);
+	}
 	public:
 	Context();
 	void parse(size_t, char**);
 	bool stop(LBA lba) {
-		if (!shared->count--) return true;
+		if (!shared.count--) return true;
 		if (last) return !(lba < last);
 		return false;
 	}
-	~Context() { sem_destroy(&shared->sem); };
+	bool unused(LBA) const;
 	bool noExt() { return include.empty() && exclude.empty(); }
 	void signature(const char*);
 	int64_t dec() {
-		lock_guard<mutex> lock(shared->mux);
-		shared->show--;
-		if (!shared->show) shared->count = 0;
-		return shared->show;
-	}
-	void setSem(const char* arg) {
-		if (!arg) return;
-		sem_destroy(&shared->sem);
-		childs = strtol(arg, nullptr, 0);
-		sem_init(&shared->sem, 1, childs);
+		int64_t show = --shared.show;
+		if (!show) shared.count = 0;
+		return show;
 	}
 };
 
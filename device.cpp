@@ -0,0 +1,186 @@
+#include <iostream>
+#include <cstdlib>
+#include <cstring>
+#include <cerrno>
+#include <tuple>
+#include <fcntl.h>
+#include <unistd.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <sys/ioctl.h>
+#include <linux/fs.h>
+
+#include "helper.hpp"
+#include "context.hpp"
+#include "device.hpp"
+
+using namespace std;
+
+Buffer::Buffer(Buffer&& buffer): device(buffer.device), data(buffer.data), size(buffer.size) {
+	buffer.data = nullptr;
+	buffer.size = 0;
+}
+
+// make buffer of at least size bytes aligned to device block
+char* Buffer::reserve(const Device& device, size_t size)
+{
+	if (data && this->size >= size) return data;
+	release();
+	this->device = &device;
+	size = (size + device.block - 1) / device.block * device.block;
+	lock_guard<mutex> guard(device.lock);
+	for (auto free = device.pool.begin(); free != device.pool.end(); free++)
+		if (free->first >= size) {
+			tie(this->size, data) = *free;
+			device.pool.erase(free);
+			return data;
+		}
+	data = static_cast<char*>(aligned_alloc(device.block, size));
+	this->size = data? size: 0;
+	return data;
+}
+
+void Buffer::release() {
+	if (!data) return;
+	lock_guard<mutex> guard(device->lock);
+	device->pool.emplace_back(size, data);
+	data = nullptr;
+	size = 0;
+}
+
+Device::Device(const string& name, bool direct): direct(direct), block(512), size(0), map(nullptr), lookup(nullptr),
+	ranges(!direct), splices(!direct)
+{
+	fd = open(name.c_str(), O_RDONLY | (direct? O_DIRECT: 0));
+	if (fd < 0 && direct) {				// file system with no direct I/O, tmpfs, some FUSE
+		int error = errno;
+		fd = open(name.c_str(), O_RDONLY);
+		if (fd < 0) return;
+		cerr << "Can not open for direct I/O: " << name << ", error: " << strerror(error) << ". Reading through page cache" << endl;
+		this->direct = false;
+		ranges = splices = true;
+	}
+	if (fd < 0) return;
+	struct stat info;
+	if (fstat(fd, &info)) return;
+	if (S_ISBLK(info.st_mode)) {		// block device is read with pread aligned to its physical block
+		unsigned int logical = 0;
+		unsigned int physical = 0;
+		ioctl(fd, BLKGETSIZE64, &size);
+		if (!ioctl(fd, BLKSSZGET, &logical) && logical > block) block = logical;
+		if (!ioctl(fd, BLKPBSZGET, &physical) && physical > block) block = physical;
+		return;
+	}
+	size = info.st_size;
+	if (info.st_blksize > block) block = info.st_blksize;
+	if (direct || !S_ISREG(info.st_mode) || !size) return;
+	void* view = mmap(nullptr, size, PROT_READ, MAP_SHARED, fd, 0);
+	if (view == MAP_FAILED) return;
+	void* random = mmap(nullptr, size, PROT_READ, MAP_SHARED, fd, 0);
+	if (random == MAP_FAILED) {
+		munmap(view, size);
+		return;
+	}
+	madvise(view, size, MADV_SEQUENTIAL);
+	madvise(random, size, MADV_RANDOM);
+	map = static_cast<const char*>(view);
+	lookup = static_cast<const char*>(random);
+}
+
+Device::~Device() {
+	for (auto& free: pool) ::free(free.second);
+	if (map) munmap(const_cast<char*>(map), size);
+	if (lookup) munmap(const_cast<char*>(lookup), size);
+	if (fd >= 0) close(fd);
+}
+
+/*
+ * return pointer to size bytes at device offset, in place if mapped
+ * otherwise data is read into buffer with block aligned read, nullptr if not available
+ */
+const char* Device::read(uint64_t offset, size_t size, Buffer& buffer) const
+{
+	if (lookup) {
+		if (offset + size > this->size) return nullptr;
+		Context::stats.read(offset, size);
+		return lookup + offset;
+	}
+	uint64_t first = align(offset);
+	size_t length = align(offset + size + block - 1) - first;
+	char* data = buffer.reserve(*this, length);
+	if (!data) return nullptr;
+	size_t done = 0;
+	while (done < length) {
+		ssize_t got = pread(fd, data + done, length - done, first + done);
+		if (got < 0) {
+			Context::stats.read(first + done, -1);
+			return nullptr;
+		}
+		if (!got) break;
+		done += got;
+	}
+	Context::stats.read(first, done);
+	if (first + done < offset + size) return nullptr;
+	return data + (offset - first);
+}
+
+// kernel does not support the copy between these files
+static bool refused(int error) {
+	return error == EXDEV || error == EINVAL || error == ENOSYS || error == EOPNOTSUPP || error == EBADF;
+}
+
+/*
+ * copy size bytes at device offset to file descriptor at its position, data stays in kernel
+ * copy_file_range for image files, splice through a pipe if refused, block devices included
+ * returns bytes copied, the rest is left for buffered copy
+ */
+uint64_t Device::copy(uint64_t offset, uint64_t size, int target) const
+{
+	uint64_t done = 0;
+	while (ranges && done < size) {
+		loff_t in = offset + done;
+		ssize_t copied = copy_file_range(fd, &in, target, nullptr, size - done, 0);
+		if (copied > 0) done += copied;
+		else if (copied < 0 && errno == EINTR) continue;
+		else {
+			if (copied < 0 && refused(errno)) ranges = false;
+			if (ranges) return done;		// device end or write error
+		}
+	}
+	if (done == size || !splices) return done;
+	int pipe[2];
+	if (pipe2(pipe, O_CLOEXEC)) return done;
+	fcntl(pipe[1], F_SETPIPE_SZ, MB);
+	while (done < size) {
+		loff_t in = offset + done;
+		ssize_t got = splice(fd, &in, pipe[1], nullptr, min<uint64_t>(size - done, MB), SPLICE_F_MOVE);
+		if (got < 0 && errno == EINTR) continue;
+		if (got <= 0) {
+			if (got < 0 && refused(errno)) splices = false;
+			break;
+		}
+		while (got) {
+			ssize_t put = splice(pipe[0], nullptr, target, nullptr, got, SPLICE_F_MOVE);
+			if (put < 0 && errno == EINTR) continue;
+			if (put <= 0) {			// data left in pipe is lost, copied again by caller
+				if (put < 0 && refused(errno)) splices = false;
+				close(pipe[0]);
+				close(pipe[1]);
+				return done;
+			}
+			got -= put;
+			done += put;
+		}
+	}
+	close(pipe[0]);
+	close(pipe[1]);
+	return done;
+}
+
+void Device::advise(uint64_t offset, size_t length, int advice) const {
+	if (!map || offset >= size) return;
+	uint64_t page = sysconf(_SC_PAGESIZE);
+	uint64_t first = offset / page * page;
+	if (offset + length > size) length = size - offset;
+	madvise(const_cast<char*>(map) + first, offset + length - first, advice);
+}
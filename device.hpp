@@ -0,0 +1,47 @@
+#pragma once
+
+#include <cstdint>
+#include <string>
+#include <vector>
+#include <mutex>
+#include <atomic>
+
+struct Device;
+
+struct Buffer {						// aligned memory from device pool, returned to the pool on release
+	const Device*	device;
+	char*			data;
+	size_t			size;
+	Buffer(): device(nullptr), data(nullptr), size(0) {}
+	Buffer(Buffer&&);
+	Buffer(const Buffer&) = delete;
+	~Buffer() { release(); }
+	char* reserve(const Device&, size_t);
+	void release();
+};
+
+/*
+ * read only access to scanned device/image
+ * regular files are memory mapped and viewed in place,
+ * block devices, files failed to map or opened for direct I/O are read with pread into a buffer
+ */
+struct Device {
+	int			fd;
+	bool		direct;					// opened with O_DIRECT, reads aligned to block size
+	uint32_t	block;					// device physical block size, I/O alignment
+	uint64_t	size;					// device/file size in bytes
+	const char*	map;					// sequential scan view of mapped image, nullptr if not mapped
+	const char*	lookup;					// random access view for parent record/data lookups
+	mutable std::vector<std::pair<size_t, char*>> pool;		// released aligned buffers
+	mutable std::mutex	lock;				// pool shared by parsing threads
+	mutable std::atomic<bool> ranges, splices;	// kernel copy methods not refused yet
+
+	Device(const std::string&, bool = false);
+	~Device();
+	operator bool() const { return fd >= 0; }
+	bool mapped() const { return map; }
+	const char* read(uint64_t offset, size_t, Buffer&) const;		// view or copy of device data
+	void advise(uint64_t offset, size_t, int) const;				// madvise range of sequential view
+	uint64_t copy(uint64_t offset, uint64_t, int) const;			// in kernel copy to file descriptor
+	uint64_t align(uint64_t offset) const { return offset / block * block; }
+};
@@ -4,6 +4,7 @@
 #include "context.hpp"
 #include "attr.hpp"
 #include "helper.hpp"
+#include "scan.hpp"
 
 const uint8_t Boot::jmp[] = {0xEB, 0x52, 0x90};
 
@@ -15,7 +16,7 @@ Boot::operator bool() const {
 
 uint32_t Boot::getSize() const {
 	uint32_t size = record.size;
-	if (record.xsize < 0) size = 1 << (-record.xsize);
+	if (record.xsize < 0) size = record.xsize > -32? 1u << -record.xsize: UINT32_MAX;
 	return size;
 }
 
@@ -61,7 +62,7 @@ Record::operator bool() const {
 }
 
 uint64_t Record::getParent(string& name) const {
-	uint16_t dir = 0;
+	uint64_t dir = 0;
 	const Name* attr = getName();
 	if (attr) {
 		dir = attr->dir;
@@ -127,9 +128,10 @@ ostream& operator<<(ostream& os, const Record* record) {
 	return os;
 }
 
-Entry::Entry(Context& context): context(context) {}
+Entry::Entry(Context& context): view(nullptr), length(0), context(context) {}
 
 Entry::operator bool() {
+	if (empty()) return false;
 	const Record* record = this->record();
 	const uint32_t* key = nullptr;
 	bool res = *record
@@ -147,89 +149,104 @@ Entry::operator bool() {
 	return res && key && *key == 0xFFFFFFFF;
 }
 
-ifstream& operator>>(ifstream& ifs, Entry& entry)
+Scan& operator>>(Scan& scan, Entry& entry)
 {
-	LBA lba = ifs.tellg() / entry.context.sector;
-	entry.resize(entry.context.sector);
-	if (!ifs.read(entry.data(), entry.size())) {
-		cerr << "Device read error at: " << outvar(lba) << endl;
-		exit(EXIT_FAILURE);
+	LBA lba = scan.tell();
+	const char* data = scan.fill(entry.context.sector);
+	if (!data) return scan;
+
+	const Boot* boot = reinterpret_cast<const Boot*>(data);
+	if (*boot && (boot->getSize() > Scan::head || (size_t)boot->sector * boot->sectors > Scan::head)) {
+		if (entry.context.verbose)			// records or clusters larger than scan can carry over
+			cerr << endl << "Skipping corrupted boot sector: " << hex << uppercase << 'x' << lba << endl;
+		scan.skip(entry.context.sector);
+		return scan;
 	}
-
-	const Boot* boot = reinterpret_cast<Boot*>(entry.data());
 	if (*boot) {
+		entry.assign(data, entry.context.sector);
+		scan.skip(entry.context.sector);
 		entry.context.sector = boot->sector;
 		entry.context.sectors = boot->sectors;
 		entry.context.mft.size = boot->getSize();
+		if (entry.context.guided) {			// scan $MFT up to volume end until its runlist is known
+			entry.context.volume = lba + boot->total + 1;
+			entry.context.mft.extents.assign(1, make_pair(lba + boot->start * boot->sectors, entry.context.volume));
+			entry.context.mft.extent = 0;
+		}
 		if (!entry.context.recover && entry.context.all) {
 			cerr << clean << hex << uppercase << 'x' << lba << tab;
-			if (dump(lba, entry)) cerr << endl << endl;
+			if (dump(lba, entry.data(), entry.size())) cerr << endl << endl;
 			cerr << boot << endl;
 			entry.context.dec();
 			confirm();
 		}
-		return ifs;
+		return scan;
 	}
 
-	const Index* index = reinterpret_cast<const Index*>(entry.data());
+	const Index* index = reinterpret_cast<const Index*>(data);
 	if (*index
 			&& !entry.context.recover
 			&& entry.context.index) {
-		entry.resize(entry.context.sector * entry.context.sectors);
-		size_t more = entry.size() - entry.context.sector;
-		if (!ifs.read(entry.data() + entry.context.sector, more)) {
+		size_t size = entry.context.sector * entry.context.sectors;
+		data = scan.fill(size);
+		if (!data) {
 			cerr << "Device read error @" << hex << lba << endl;
 			exit(EXIT_FAILURE);
 		}
+		entry.assign(data, size);
+		scan.skip(size);
 		cerr << clean << hex << uppercase << 'x' << lba << tab;
-		const Index* index = reinterpret_cast<const Index*>(entry.data());
-		if (dump(lba, entry)) cerr << endl << endl;
+		index = reinterpret_cast<const Index*>(entry.data());
+		if (dump(lba, entry.data(), entry.size())) cerr << endl << endl;
 		cerr << index << endl;
 		entry.context.dec();
 		confirm();
-		return ifs;
+		return scan;
 	}
 
-	const Record* record = reinterpret_cast<Record*>(entry.data());
+	const Record* record = reinterpret_cast<const Record*>(data);
 	if (!*record) {
 		if (entry.context.all && entry.context.verbose) {
+			entry.assign(data, entry.context.sector);
 			cerr << endl << hex << uppercase << 'x' << lba << tab;
 			entry.context.dec();
-			if (dump(lba, entry)) {
+			if (dump(lba, entry.data(), entry.size())) {
 				cerr << endl;
 				confirm();
 			}
 		}
-		return ifs;;
+		scan.skip(entry.context.sector);
+		return scan;
 	}
 
 	auto alloc = record->alloc;
 	if (alloc > entry.context.mft.size) {
 		if (entry.context.verbose) {
+			entry.assign(data, entry.context.sector);
 			cerr << endl << "Not resizing to " << outvar(alloc) << endl;
-			if (dump(lba, entry)) cerr << endl;
+			if (dump(lba, entry.data(), entry.size())) cerr << endl;
 			cerr << "Skipping currupted entry: "
 				<< hex << uppercase << 'x' << lba << endl;
 			confirm();
 		}
-		return ifs;
+		scan.skip(entry.context.sector);
+		return scan;
 	}
 
-	if (alloc != entry.size()) entry.resize(alloc);
-	size_t more = alloc - entry.context.sector;
-	if (more) {
-		if (!ifs.read(entry.data() + entry.context.sector, more)) {
-			cerr << endl << "Device read error @" << hex << lba << endl;
-			exit(EXIT_FAILURE);
-		}
+	if (alloc < entry.context.sector) alloc = entry.context.sector;
+	data = scan.fill(alloc);
+	if (!data) {
+		cerr << endl << "Device read error @" << hex << lba << endl;
+		exit(EXIT_FAILURE);
 	}
-
+	scan.skip(alloc);
+	record = reinterpret_cast<const Record*>(data);
+	entry.assign(data, alloc);
 	entry.resize(record->size);
 	if (entry.context.verbose) {
-		record = reinterpret_cast<Record*>(entry.data());
 		cout << endl << hex << uppercase << 'x' << lba << tab;
-		if (dump(lba, entry)) cout << endl;
+		if (dump(lba, entry.data(), entry.size())) cout << endl;
 		cout << record;
 	}
-	return ifs;
+	return scan;
 }
@@ -5,6 +5,7 @@
 #include "attr.hpp"
 
 class Context;
+struct Scan;
 
 struct __attribute__ ((packed)) Boot {
 	static const uint8_t jmp[];
@@ -79,10 +80,17 @@ struct __attribute__ ((packed)) Record {
 	operator bool() const;
 };
 
-struct Entry:std::vector<char> {
+struct Entry {
+	const char*	view;		// entry data in place, in device map or scan window
+	size_t		length;
 	operator bool();
 	Context& context;
 	Entry(Context&);
+	const char* data() const { return view; }
+	size_t size() const { return length; }
+	bool empty() const { return !length; }
+	void assign(const char* data, size_t size) { view = data; length = size; }
+	void resize(size_t size) { length = size; }
 	const Record* record() const { return reinterpret_cast<const Record*>(data()); }
-	friend ifstream& operator>>(ifstream& ifs, Entry& entry);
+	friend Scan& operator>>(Scan&, Entry&);
 };
@@ -1,5 +1,6 @@
 #include <filesystem>
 #include <sys/stat.h>
+#include <fcntl.h>
 #include <unistd.h>
 #include <string.h>
 #include <vector>
@@ -9,44 +10,135 @@
 #include "context.hpp"
 #include "entry.hpp"
 #include "file.hpp"
+#include "device.hpp"
+#include "checkpoint.hpp"
+#include "writer.hpp"
 
 using namespace std;
 
-unordered_map<uint64_t, pair<string, uint64_t>> File::dirs;
+Dirs File::dirs;
 
-ostream& operator<<(ostream& os, const Time_t time) {
-	os << put_time(localtime(reinterpret_cast<const time_t*>(&time)), "%Y.%m.%d %H:%M:%S");
-	return os;
+pair<string, uint64_t> Dirs::at(uint64_t rec) const {
+	shared_lock<shared_mutex> guard(lock);
+	if (!known(rec)) throw out_of_range("directory not known");
+	return make_pair(name(table[rec]), table[rec].parent);
+}
+
+bool Dirs::count(uint64_t rec) const {
+	shared_lock<shared_mutex> guard(lock);
+	return known(rec);
+}
+
+// first one kept, records past table limit dropped
+void Dirs::insert(uint64_t rec, const pair<string, uint64_t>& dir) {
+	unique_lock<shared_mutex> guard(lock);
+	if (rec >= limit) return;
+	if (rec >= table.size()) table.resize(rec + 1);
+	if (table[rec].known) return;
+	table[rec] = { uint32_t(names.size()), 0, 0, uint16_t(dir.first.size()), dir.second, true, false, false };
+	names.append(dir.first);
 }
 
 /*
- * test file extension belongs to a set of extensions
- * return value depends on weather the match is expected or not
+ * path of directory from root, each name followed by /, and if $RECYCLE.BIN is on the way
+ * directories up to root or one resolved before are resolved and cached on the way back
+ * if a directory on the way is unknown, path below it is given and its record number
  */
-bool File::hit(const set<string>& entries, bool must)		// return means continue checking
+bool Dirs::path(uint64_t rec, string& path, bool& trash, uint64_t& missing)
 {
-	if (!valid) return false;								// no further checking
-	if (entries.empty()) return true;						// continue other checking
-	valid = !must;
-	string ext = this->ext;
-	lower(ext);
-	for (const auto& extension: entries) {
-		auto hit = context.mime.find(extension);
-		if (hit != context.mime.end())
-			if (hit->second.find(ext) != hit->second.end()) {
-				valid = must;
-				return true;
+	{
+		shared_lock<shared_mutex> guard(lock);
+		if (rec < table.size() && table[rec].cached) {
+			path.assign(paths, table[rec].path, table[rec].size);
+			trash = table[rec].trash;
+			return true;
+		}
+	}
+	unique_lock<shared_mutex> guard(lock);
+	vector<uint64_t> chain;		// directories not cached, from the one asked up
+	for (uint64_t dir = rec; ; dir = table[dir].parent) {
+		if (!known(dir)) {
+			path = "/";
+			trash = false;
+			for (auto dir: chain) {
+				string name = this->name(table[dir]);
+				if (name == "$RECYCLE.BIN") trash = true;
+				path = "/" + name + path;
 			}
-		if (ext == extension) {
-			valid = must;
+			missing = dir;
 			return false;
 		}
+		if (table[dir].cached) break;
+		chain.push_back(dir);
+		if (table[dir].parent == dir || chain.size() > table.size()) {		// root, or loop taken as one
+			table[dir].cached = true;
+			table[dir].path = paths.size();
+			table[dir].size = 1;
+			paths.append("/");
+			chain.pop_back();
+			break;
+		}
 	}
-	return false;
+	for (auto dir = chain.rbegin(); dir != chain.rend(); dir++) {
+		Dir& entry = table[*dir];
+		const Dir& parent = table[entry.parent];
+		path.assign(paths, parent.path, parent.size).append(names, entry.name, entry.length).append("/");
+		entry.trash = parent.trash || name(entry) == "$RECYCLE.BIN";
+		entry.path = paths.size();
+		entry.size = path.size();
+		entry.cached = true;
+		paths.append(path);
+	}
+	path.assign(paths, table[rec].path, table[rec].size);
+	trash = table[rec].trash;
+	return true;
+}
+
+// new $MFT, record numbers refer to another volume
+void Dirs::clear(uint64_t records) {
+	unique_lock<shared_mutex> guard(lock);
+	if (records) limit = records;
+	table.clear();
+	names.clear();
+	paths.clear();
+}
+
+unordered_map<uint64_t, pair<string, uint64_t>> Dirs::copy() const {
+	shared_lock<shared_mutex> guard(lock);
+	unordered_map<uint64_t, pair<string, uint64_t>> map;
+	for (uint64_t rec = 0; rec < table.size(); rec++)
+		if (table[rec].known) map.emplace(rec, make_pair(name(table[rec]), table[rec].parent));
+	return map;
+}
+
+ostream& operator<<(ostream& os, const Time_t time) {
+	tm local;
+	if (localtime_r(reinterpret_cast<const time_t*>(&time), &local))
+		os << put_time(&local, "%Y.%m.%d %H:%M:%S");
+	else os << "time:" << hex << uppercase << 'x' << uint64_t(time) << dec;	// out of range
+	return os;
+}
+
+// find file extension for matching include/exclude parameter
+void File::setExt()
+{
+	if (name.npos == name.find('.')) return;
+	istringstream ext(name);
+	while (getline(ext, this->ext, '.'));
 }
 
 bool File::empty() const { return !dir && runlist.empty() && !content; }
 
+bool Run::sparse() const {
+	for (auto& run: list) if (sparse(run)) return true;
+	return false;
+}
+
+bool File::sparse() const {
+	for (auto& entry: runlist) if (entry.second.sparse()) return true;
+	return false;
+}
+
 string File::getType() const {
 	string type;
 	if (error) type = '!';
@@ -61,102 +153,101 @@ string File::getType() const {
 	return type;
 }
 
-void File::mapDir(const Record* record, uint64_t offset) {
+bool File::mapDir(const Record* record) {
 	string name;
 	uint64_t parent;
-	if (dirs.find(record->rec - offset) == dirs.end()) {
+	if (!dirs.count(record->rec)) {
 		parent = record->getParent(name);
-		dirs[record->rec - offset] = make_pair(name, parent);
+		dirs.insert(record->rec, make_pair(name, parent));
 	}
+	return dirs.count(record->rec);
 }
 
-bool File::setPath(const Record* record)
+bool File::setPath(const Record* record, bool retry)
 {
 	if (!valid && index) return false;
-	path = "/";
-	bool trash = false;
-	uint64_t dir = parent;
 	uint64_t last = 0;
-	try {
-		string name;
-		do {
-			last = dir;
-			tie(name, dir) = dirs.at(dir);
-			if (dir == last) break;
-			if (name == "$RECYCLE.BIN") trash = true;
-			path = "/" + name + path;
-		} while (true);
-	}
-	catch (...) {
+	bool found = dirs.path(parent, path, trash, last);
+	if (!retry) Stats::add(found? Context::stats.hits: Context::stats.misses);		// once per lookup
+	if (!found) {
 		path = "/@" + to_string(last) + path;
-		ifstream idev(context.dev, ios::in | ios::binary);
-		if (idev.is_open()) {
-			int64_t offset = int64_t((last - index) * entry) / context.sector;
-			int64_t dir = lba + offset;
-			if (idev.seekg(dir * context.sector)) {
-				vector<char> buffer(entry);
-				idev.read(buffer.data(), buffer.size());
-				const Record* parent = reinterpret_cast<const Record*>(buffer.data());
-				if (*parent) {
-					if (parent->dir())
-						mapDir(parent, 0);
-					else {
-						offset = int64_t((last + (1<<16) - index) * entry) / context.sector;
-						dir = lba + offset;
-						if (idev.seekg(dir * context.sector)) {
-							idev.read(buffer.data(), buffer.size());
-							Record* parent = reinterpret_cast<Record*>(buffer.data());
-							if (*parent && parent->dir()) mapDir(parent, 1<< 16);
-							else {
-								error = true;
-								return false;
-							}
-						}
-					}
-					return setPath(record);
-				}
-				error = true;
-				return false;
-			}
+		Buffer buffer;
+		int64_t dir = locate(last);
+		if (dir >= 0) {
+			const Record* parent = reinterpret_cast<const Record*>(context.device->read(dir * context.sector, entry, buffer));
+			if (parent && *parent && parent->dir() && parent->rec == last && mapDir(parent))
+				return setPath(record, true);
+			error = true;
+			return false;
 		}
 	}
 	if (index) valid = context.recycle || !trash;
 	return true;
 }
 
+/*
+ * lba of record, through $MFT extents if this record is in them, relative to this one otherwise
+ * does not depend on records parsed before
+ */
+int64_t File::locate(uint64_t rec) const
+{
+	auto& extents = context.mft.extents;
+	bool inside = false;
+	for (auto& extent: extents) inside |= lba >= extent.first && lba < extent.second;
+	if (inside) {
+		uint64_t offset = rec * entry / context.sector;
+		for (auto& extent: extents) {
+			if (offset < extent.second - extent.first) return extent.first + offset;
+			offset -= extent.second - extent.first;
+		}
+	}
+	return lba + int64_t((rec - index) * entry) / context.sector;
+}
+
 bool File::setBias(const Record* record) const
 {
 	if (!valid) return false;
 	if (!record->rec) return false;
-	ifstream idev(context.dev, ios::in | ios::binary);
-	if (idev.is_open()) {
-		int64_t offset = int64_t(index) * entry / context.sector;
-		int64_t first = lba - offset;
-		if (idev.seekg(first * context.sector)) {
-			vector<char> buffer(entry);
-			idev.read(buffer.data(), buffer.size());
-			const Record* record = reinterpret_cast<const Record*>(buffer.data());
-			File mft(first, record, context);
-		}
-	}
+	int64_t offset = int64_t(index) * entry / context.sector;
+	int64_t first = lba - offset;
+	Buffer buffer;
+	const Record* mft = reinterpret_cast<const Record*>(context.device->read(first * context.sector, entry, buffer));
+	if (mft) File file(first, mft, context);
 	return true;
 }
 
 File::File(LBA lba, const Record* record, Context& context):
-	context(context), error(false), pid(-1),
-	valid(false), lba(lba), dir(false), size(0), alloc(0),
-	content(nullptr), done(false), exists(false)
+	valid(false), done(false), exists(false), dir(false), error(false), trash(false), filtered(false),
+	lba(lba), index(0), parent(0), time(), access(), size(0), alloc(0), fd(-1),
+	arena(store, sizeof(store)), runlist(&arena), content(nullptr), context(context)
 {
 	if (!record || !*record) return;		// based on entry magic/key word "FILE"
 	used = record->used();
-	if (!use()) return;						// use if not used and recovering deleted files
+	if ((!use() && !context.catalogue)		// use if not used and recovering deleted files, catalogue has all
+			|| !context.filter.pass(record)) {		// rejected on record bytes, not decoded
+		Stats::add(Context::stats.skipped);
+		return;
+	}
+	Stats::add(Context::stats.parsed);
 	entry = record->alloc;
 	index = record->rec;
+	seq = record->seq;
 	dir = record->dir();
-	const Attr* next = (const Attr*)(record->key + record->attr);
-	while (next) next = next->parse(this);	// parse file entry attributes
-	if (hit(context.include, true)) hit(context.exclude, false);	// no file extension match not valid
-	setPath(record);
+	const Attr* data[16];		// attributes decoded when file is wanted
+	size_t count = 0;
+	for (const Attr* next = (const Attr*)(record->key + record->attr); next; ) {
+		const Attr* attr = next;
+		next = attr->head(this);
+		if (!attr->deferred()) continue;
+		if (count < std::size(data)) data[count++] = attr;
+		else attr->parse(this);
+	}
+	if (context.catalogue) setPath(record);		// path of files filtered out catalogued too
+	valid = context.filter.hit(ext, valid);		// no file extension match not valid
+	if (!context.catalogue) setPath(record);
+	if (context.filter && !context.filter.match(*this)) filtered = true, valid = false;
+	if (valid || dir || !index || context.all || context.catalogue)		// shown, recovered or catalogued
+		for (size_t i = 0; i < count; i++) data[i]->parse(this);
 	if (!index && !error) {		// this is MFT file own entry. MFT mirror shall be excluded by !error condition
 		if (runlist.empty()) {
 			if (context.verbose) { 
@@ -168,22 +259,84 @@ File::File(LBA lba, const Record* record, Context& context):
 		context.mft.first = lba;
 		context.bias = lba - runlist[0].list[0].first * context.sectors;
 		context.mft.last = runlist[0].list[0].second * context.sectors + context.bias;
+		setExtents();
+		setBitmap();
 		cerr << clean << "New context LBA bias based on last $MFT record: "
 			<< outvar(context.bias) << '@' << outvar(lba) << endl;
-		dirs.clear();
+		dirs.clear(alloc / context.mft.size);
 	}
 	if (index && valid)
 		if (!context.mft.first && !context.mft.last)
 			setBias(record);
 }
 
+/*
+ * $MFT data runs as device lba ranges in record order, for the guided scan
+ * runs not covering whole $MFT (continued in attribute list) leave no extents
+ */
+void File::setExtents() const
+{
+	auto& extents = context.mft.extents;
+	extents.clear();
+	context.mft.extent = 0;
+	uint64_t clusters = 0;
+	for (auto& entry: runlist) {
+		size_t count = entry.second.count;
+		for (auto& run: entry.second.list) {
+			if (Run::sparse(run)) break;
+			VCN last = min(run.second, run.first + count);
+			if (last <= run.first) break;
+			extents.emplace_back(run.first * context.sectors + context.bias, last * context.sectors + context.bias);
+			clusters += last - run.first;
+			count -= last - run.first;
+		}
+	}
+	if (clusters * context.sectors * context.sector < alloc) extents.clear();
+}
+
+/*
+ * $MFT record bitmap of the $MFT record setting context, resident one copied when parsed, nonresident read
+ */
+void File::setBitmap() const
+{
+	auto& bits = context.mft.bitmap;
+	if (bitmap.list.empty()) {
+		bits.assign(this->bits.begin(), this->bits.end());		// none clears one of previous $MFT
+		return;
+	}
+	bits.clear();
+	size_t cluster = context.sector * context.sectors;
+	Buffer buffer;
+	for (auto& run: bitmap.list) {
+		if (bits.size() >= bitmap.count) break;
+		size_t size = min((run.second - run.first) * cluster, bitmap.count - bits.size());
+		if (Run::sparse(run)) {		// records never used
+			bits.insert(bits.end(), size, 0);
+			continue;
+		}
+		int64_t first = run.first * context.sectors + context.bias;
+		const char* data = first < 0? nullptr: context.device->read(first * context.sector, size, buffer);
+		if (!data) {
+			cerr << clean << "Can not read $MFT bitmap @" << outvar(first) << endl;
+			bits.clear();
+			return;
+		}
+		bits.insert(bits.end(), data, data + size);
+	}
+}
+
 bool File::use() const { return used || context.undel; }
 
+// directories with -d not recovering, files to recover, anything with -a
+bool File::shown() const
+{
+	if (context.all) return true;
+	if (dir) return !context.recover && context.dirs && !filtered;
+	return use() && valid && !exists && !empty();
+}
+
 ostream& operator<<(ostream& os, const File& file) {
-	if (file.done && !file.context.all) {
-		if (file.dir) { if (file.context.recover || !file.context.dirs) return os; }
-		else if (!file.use() || !file.valid || file.exists || file.empty()) return os;
-	}
+	if (file.done && !file.shown()) return os;
 	cerr << clean;			// just print file basic info and return to line begin
 	os << hex << uppercase << 'x' << file.lba << tab << file.getType();
 	if (file.use()) os<< '/' << dec << file.index << tab << file.path << file.name << tab << file.time;
@@ -200,11 +353,12 @@ ostream& operator<<(ostream& os, const File& file) {
 			os << "size:" << (file.size > kB? file.size/kB: file.size);
 			if (file.size > kB) os << 'k';
 			if (!file.runlist.empty())
-				for (auto entry: file.runlist) {
+				for (auto& entry: file.runlist) {
 					os << tab << entry.second.count << ':';
-					for (auto run: entry.second.list)
+					for (auto& run: entry.second.list)
 						// os << outpaix(run.first, run.second) << tab;
-						os << outpaix(run.first * file.context.sectors, run.second * file.context.sectors) << tab;
+						if (Run::sparse(run)) os << "sparse:" << outvar((run.second - run.first) * file.context.sectors) << tab;
+						else os << outpaix(run.first * file.context.sectors, run.second * file.context.sectors) << tab;
 					// os << "max:" << outvar(Runlist::maxLcn * file.context.sectors) << tab;
 				}
 		}
@@ -222,56 +376,48 @@ ostream& operator<<(ostream& os, const File& file) {
 
 void File::recover()
 {
-	cerr << *this;		// just print file basic info and return to line begin
-	if (use() && valid && context.recover && size > context.size * MB && !dir) {
-		sem_wait(&context.shared->sem);
-		pid = fork();
-		if (pid < 0) {
-			sem_post(&context.shared->sem);
-			cerr << "Failed to create read process, error: " << strerror(errno) << endl;
-			cerr << "Continue in main: " << name << endl;
-		}
-		else if (pid) {		// parent process, return
-			int sem;
-			sem_getvalue(&context.shared->sem, &sem);
-			if (context.verbose) cerr << "New child/" << sem << ':' << pid << '/' << index << ',' << endl;
-			return;
-		}
+	if (context.writer) {
+		copy();
+		context.writer->add(*this);
+		return;
 	}
+	cerr << *this;		// just print file basic info and return to line begin
+	copy();
+	cout << *this;
+}
 
-	if (use() && valid && !empty())
-		if (!error || context.undel)
-			if (context.recover ^ dir) {
-				ifstream idev(context.dev, ios::in | ios::binary);
-				if (idev.is_open())
-					idev >> *this;
-				else {
-					error = true;
-					cerr << "Can not open device: " << context.dev << endl
-						<< "Error: " << strerror(errno) << endl;
-					confirm();
-				}
-			}
+// file data or directory index is to be read from device
+bool File::pending() const
+{
+	return use() && valid && !empty()
+		&& (!error || context.undel)
+		&& (context.recover ^ dir);
+}
 
+void File::copy()
+{
+	if (pending()) *context.device >> *this;
 	if (!context.recover || context.all) done = true;
-
-	cout << *this;
-
-	if (!pid) {
-		sem_post(&context.shared->sem);
-		exit(EXIT_SUCCESS);
-	}
 }
 
-ifstream& operator>>(ifstream& ifs, File& file)
+const Device& operator>>(const Device& device, File& file)
 {
 	string full;
 	utimbuf times;
-	vector<char> buffer(file.context.sector * file.context.sectors);
-	streamsize chunk, bytes = file.size;
-	if (!file.runlist.empty())
-		for (auto entry: file.runlist)
-			for (auto run: entry.second.list) {
+	Buffer buffer;
+	size_t cluster = file.context.sector * file.context.sectors;
+	uint64_t bytes = file.size;
+	if (!file.runlist.empty()) {
+		vector<pair<uint64_t, uint64_t>> extents;		// device offset and size of physically contiguous runs
+		const uint64_t hole = ~0ULL;					// extent offset of sparse runs
+		for (auto& entry: file.runlist)
+			for (auto& run: entry.second.list) {
+				uint64_t size = min<uint64_t>(run.second - run.first, entry.second.count) * cluster;
+				if (Run::sparse(run)) {
+					if (!extents.empty() && extents.back().first == hole) extents.back().second += size;
+					else extents.emplace_back(hole, size);
+					continue;
+				}
 				int64_t first = run.first * file.context.sectors;
 				first += file.context.bias;
 				if (first < 0) {
@@ -279,71 +425,104 @@ ifstream& operator>>(ifstream& ifs, File& file)
 						<< ". Try scanning disk device not partition or partition not a file" << endl;
 					file.error = true;
 					confirm();
-					return ifs;
+					return device;
 				}
-				if (!ifs.seekg(first * file.context.sector))
-					if (file.context.verbose) cerr << "Error seeking to lba: " << outpaix(first, ifs.tellg()) << ", error: " << strerror(errno) << endl;
-				auto lcn = run.first;
-				size_t i = 0;
-				for (; lcn < run.second && i < entry.second.count; lcn++, i++) {
-					auto chunk = bytes/buffer.size()? buffer.size(): bytes % buffer.size();
-					if (!ifs.read(buffer.data(), chunk)) {
-						if (file.context.verbose) cerr << "Error reading: "
-							<< outpaix(lcn, ifs.tellg()) << ", error: " << strerror(errno) << endl;
+				uint64_t offset = first * file.context.sector;
+				if (!extents.empty() && extents.back().first + extents.back().second == offset)
+					extents.back().second += size;
+				else extents.emplace_back(offset, size);
+			}
+		size_t slice = max(file.context.window * MB / cluster, size_t(1)) * cluster;
+		string zero;
+		for (auto& extent: extents) {
+			uint64_t offset = extent.first == hole? 0: extent.first;
+			uint64_t end = offset + min(extent.second, bytes);
+			bytes -= end - offset;
+			if (extent.first == hole && file.dir) continue;		// no index blocks to parse
+			while (offset < end) {
+				if (!file.dir && file.fd >= 0) {		// rest of extent copied at once
+					if (extent.first == hole) {
+						if (!file.skip(end - offset)) {
+							file.error = true;
+							goto out;
+						}
+						break;
+					}
+					if (!file.transfer(offset, end - offset)) {
+						if (file.context.verbose) cerr << "Error copying: "
+							<< outvar(offset / file.context.sector) << ", error: " << strerror(errno) << endl;
 						file.error = true;
 						goto out;
 					}
-					bytes -= chunk;
-					if (!file.dir) {
-						if (!file.ofs.is_open()) {
-							file.magic = *reinterpret_cast<uint64_t*>(buffer.data()) & file.context.mask;
-							if (file.context.magic && file.magic != file.context.magic) {
-								if (Context::verbose) {
-									cerr << "No magic/x" << hex << file.context.mask << ':'
-										<< outpaix(file.magic, file.context.magic) << ',';
-									cerr.write(&file.cmagic, sizeof(file.magic)) << '/';
-									cerr.write(&file.context.cmagic, sizeof(file.context.magic)) << endl;
-								}
-								file.valid = false;
-								goto out;
-							}
-							if (!file.context.shared->show) return ifs;
-							if (!file.open()) {
-								if (!file.done) file.error = false;
-								return ifs;
-							}
+					break;
+				}
+				// directory index read in slices, file first cluster for its magic
+				size_t size = min<uint64_t>(end - offset, file.dir? slice: cluster);
+				if (extent.first == hole) zero.resize(size);		// first cluster of file is sparse
+				const char* data = extent.first == hole? zero.data(): device.read(offset, size, buffer);
+				if (!data) {
+					if (file.context.verbose) cerr << "Error reading: "
+						<< outvar(offset / file.context.sector) << ", error: " << strerror(errno) << endl;
+					file.error = true;
+					goto out;
+				}
+				offset += size;
+				if (!file.dir) {
+					file.magic = 0;
+					memcpy(&file.magic, data, min(size, sizeof(file.magic)));
+					file.magic &= file.context.mask;
+					if (file.context.magic && file.magic != file.context.magic) {
+						if (Context::verbose) {
+							cerr << "No magic/x" << hex << file.context.mask << ':'
+								<< outpaix(file.magic, file.context.magic) << ',';
+							cerr.write(&file.cmagic, sizeof(file.magic)) << '/';
+							cerr.write(&file.context.cmagic, sizeof(file.context.magic)) << endl;
 						}
-						file.ofs.write(buffer.data(), chunk);
+						file.valid = false;
+						goto out;
 					}
-					else {
-						const Index* index = reinterpret_cast<const Index*>(buffer.data());
-						if (*index)
-							index->header->parse(&file);
-						else
-							file.error = true;
-						if (!*index && file.context.dirs) {
-							if (file.context.confirm) cerr << file << endl;
-							confirm("Bad INDX cluster");
-						}	
+					if (!file.context.shared.show) return device;
+					if (!file.open()) {
+						if (!file.done) file.error = false;
+						return device;
+					}
+					if (extent.first == hole? !file.skip(size): !file.write(data, size)) {
+						file.error = true;
+						goto out;
+					}
+					continue;
+				}
+				for (size_t at = 0; at < size; at += cluster) {
+					const Index* index = reinterpret_cast<const Index*>(data + at);
+					if (*index)
+						index->header->parse(&file);
+					else
+						file.error = true;
+					if (!*index && file.context.dirs) {
+						if (file.context.confirm) cerr << file << endl;
+						confirm("Bad INDX cluster");
 					}
 				}
 			}
+		}
+	}
 	else if (file.content) {
 		file.magic = *reinterpret_cast<const uint16_t*>(file.content);
 		if (file.context.magic && file.context.magic != (file.magic & file.context.mask))
 			file.valid = false;
-		else if (!file.open()) return ifs;
-		else file.ofs.write(file.content, file.size);
+		else if (!file.open()) return device;
+		else if (!file.write(file.content, file.size)) file.error = true;
 	}
 	else		// empty file
 	{
 		file.done = true;
-		return ifs;
+		return device;
 	}
 	file.done = true;
 out:
-	if (file.ofs.is_open()) file.ofs.close();
-	else return ifs;
+	if (file.fd < 0) return device;
+	close(file.fd);
+	file.fd = -1;
 
 	full = file.context.dir + file.path + file.name;
 	if (file.error && !file.context.undel) unlink(full.c_str());
@@ -353,13 +532,15 @@ out:
 			cerr << "Failed to update file time modification: " << full << ", error: " << strerror(errno) << endl;
 			confirm();
 		}
+		if (file.context.checkpoint) file.context.checkpoint->add(file.lba);
 	}
-	return ifs;
+	return device;
 }
 
 void File::mangle() {
 	if (context.format == Context::Format::None) return;
-	tm* te = localtime(reinterpret_cast<const time_t*>(&time));
+	tm local = {};		// thread safe, files are opened by recovery threads
+	tm* te = localtime_r(reinterpret_cast<const time_t*>(&time), &local)?: &local;
 	ostringstream path;
 	path << '/' << te->tm_year + 1900 << '/';
 	if (context.format > Context::Format::Year) {
@@ -372,6 +553,10 @@ void File::mangle() {
 
 bool File::open()
 {
+	if (context.checkpoint && context.checkpoint->written(lba)) {		// before scan resumed
+		done = exists = true;
+		return false;
+	}
 	bool magic = true;
 	string target(context.dir);
 	mangle();
@@ -418,15 +603,70 @@ bool File::open()
 		}
 	}
 
-	ofstream file(full, ios::out | ios::binary);
-	if (!file.is_open()) {
+	fd = ::open(full.c_str(), O_WRONLY | O_CREAT | O_TRUNC | O_CLOEXEC, 0666);
+	if (fd < 0) {
 		cerr << "Can not open file for write: " << full
 			<< ", error: " << strerror(errno) << endl;
 		confirm();
 		return false;
 	}
+	Stats::add(Context::stats.files);
 	if (context.verbose) cerr << "File opened for write: " << full << endl;
+	// reserve target space at once, best effort, sparse files keep their holes
+	if (!dir && size && !sparse()) fallocate(fd, FALLOC_FL_KEEP_SIZE, 0, size);
+	return true;
+}
+
+bool File::write(const char* data, size_t size)
+{
+	while (size) {
+		ssize_t done = ::write(fd, data, size);
+		if (done < 0 && errno == EINTR) continue;
+		if (done <= 0) {
+			if (context.verbose) cerr << "Write error: " << name << ", error: " << strerror(errno) << endl;
+			return false;
+		}
+		Stats::add(Context::stats.written, done);
+		data += done;
+		size -= done;
+	}
+	return true;
+}
+
+/*
+ * leave a hole of size bytes at the end of target file, sparse run is not read
+ */
+bool File::skip(uint64_t size)
+{
+	off_t end = lseek(fd, size, SEEK_CUR);
+	if (end < 0 || ftruncate(fd, end)) {
+		if (context.verbose) cerr << "Seek error: " << name << ", error: " << strerror(errno) << endl;
+		return false;
+	}
+	context.holes += size;
+	return true;
+}
 
-	ofs = std::move(file);
+/*
+ * copy size bytes of device at offset to the end of target file
+ * in kernel if device allows, otherwise in scan window sized reads through user space
+ */
+bool File::transfer(uint64_t offset, uint64_t size)
+{
+	uint64_t done = context.device->copy(offset, size, fd);
+	if (done) {
+		Context::stats.read(offset, done);
+		Stats::add(Context::stats.written, done);
+	}
+	Buffer buffer;
+	size_t cluster = context.sector * context.sectors;
+	size_t slice = max(context.window * MB / cluster, size_t(1)) * cluster;
+	for (offset += done, size -= done; size; ) {
+		size_t chunk = min<uint64_t>(size, slice);
+		const char* data = context.device->read(offset, chunk, buffer);
+		if (!data || !write(data, chunk)) return false;
+		offset += chunk;
+		size -= chunk;
+	}
 	return true;
 }
@@ -6,49 +6,104 @@
 #include <map>
 #include <set>
 #include <unordered_map>
+#include <shared_mutex>
+#include <memory_resource>
 
 using VCN = uint64_t;
 enum class Time_t: uint64_t;
 
 struct Context;
 struct Record;
+struct Device;
 
 struct Run {
+	using allocator_type = std::pmr::polymorphic_allocator<std::pair<VCN, VCN>>;
+	static const VCN hole = 1ULL << 63;		// sparse run lcn, no clusters on device
 	size_t count;
-	std::vector<std::pair<VCN, VCN>> list;
+	std::pmr::vector<std::pair<VCN, VCN>> list;
+	Run(const allocator_type& alloc = {}): count(0), list(alloc) {}
+	Run(const Run& run, const allocator_type& alloc = {}): count(run.count), list(run.list, alloc) {}
+	Run(Run&& run, const allocator_type& alloc): count(run.count), list(std::move(run.list), alloc) {}
+	Run& operator=(const Run&) = default;
+	static bool sparse(const std::pair<VCN, VCN>& run) { return run.first >= hole; }
+	bool sparse() const;
+};
+
+/*
+ * directory name and parent by record number, filled while parsing threads resolve paths
+ * table indexed by record number, grown on demand up to the $MFT record count or device size in records,
+ * names and paths resolved up to root are kept in arenas, a path once resolved is not walked again
+ */
+struct Dirs {
+	struct Dir {
+		uint32_t	name, path;			// offsets in arenas
+		uint32_t	size;				// of path
+		uint16_t	length;				// of name
+		uint64_t	parent;
+		bool		known, cached, trash;
+	};
+	std::pair<std::string, uint64_t> at(uint64_t) const;		// throws out_of_range if unknown
+	bool count(uint64_t) const;
+	void insert(uint64_t, const std::pair<std::string, uint64_t>&);
+	bool path(uint64_t, std::string&, bool&, uint64_t&);		// false if a directory on the way is unknown
+	void clear(uint64_t records = 0);		// records table can hold, limit kept if none
+	std::unordered_map<uint64_t, std::pair<std::string, uint64_t>> copy() const;
+	private:
+	mutable std::shared_mutex lock;
+	std::vector<Dir> table;
+	uint64_t	limit = 1ULL << 32;		// record numbers in FILE records are 32 bit
+	std::string	names, paths;
+	bool known(uint64_t rec) const { return rec < table.size() && table[rec].known; }
+	std::string name(const Dir& dir) const { return names.substr(dir.name, dir.length); }
 };
 
 struct File
 {
-	pid_t		pid;
-	bool		valid, done, used, exists, dir, error;
+	bool		valid, done, used, exists, dir, error, trash;
+	bool		filtered;		// rejected by -z/-T/-P/--deleted/--dirs, directory not shown either
 	LBA			lba;
 	uint64_t	index, parent;
+	uint16_t	seq;			// record sequence number
 	std::string	name, ext, path;
 	Time_t		time, access;
 	uint64_t	size, alloc, mask, entry;
 	union		{ uint64_t magic; char cmagic; };
-	std::ofstream ofs;
-	std::map<VCN, Run> runlist;
+	int			fd;				// target file descriptor
+	char		store[256];		// record decoding arena, runlist in most cases
+	std::pmr::monotonic_buffer_resource arena;
+	std::pmr::map<VCN, Run> runlist;
+	Run			bitmap;			// $MFT record bitmap runs, count in bytes, record 0 only
+	std::string	bits;			// resident $MFT record bitmap, record 0 only
 	std::vector<std::pair<uint64_t, std::string>> entries;
 	const char*	content;
+	std::string	resident;		// copy of resident data, content points to it
 	Context&	context;
-	static	std::unordered_map<uint64_t, std::pair<std::string, uint64_t>> dirs;
+	static	Dirs dirs;
 
 	std::string	getType() const;
 	void mangle();
+	void setExt();
 	bool open();
-	bool hit(const std::set<std::string>&, bool);
+	bool write(const char*, size_t);
+	bool transfer(uint64_t, uint64_t);
+	bool skip(uint64_t);
 	bool parse();
 	bool empty() const;
+	bool sparse() const;
 	operator bool() const { return valid; }
 	bool setBias(const Record*) const;
-	bool setPath(const Record*);
-	void mapDir(const Record*, uint64_t);
+	void setExtents() const;
+	int64_t locate(uint64_t) const;
+	void setBitmap() const;
+	bool setPath(const Record*, bool retry = false);	// retry after parent directory mapped
+	bool mapDir(const Record*);			// directory record known
 	File(LBA, const Record*, struct Context&);
 	bool use() const;
-	void recover();
+	bool shown() const;			// line shown when done
+	void recover();				// copy and show
+	bool pending() const;
+	void copy();
 };
 
 std::ostream& operator<<(std::ostream& os, const File&);
-std::ifstream& operator>>(std::ifstream& os, File&);
+const Device& operator>>(const Device&, File&);
@@ -0,0 +1,186 @@
+#include <iostream>
+#include <iomanip>
+#include <limits>
+#include <cctype>
+#include <fnmatch.h>
+
+#include "helper.hpp"
+#include "context.hpp"
+#include "entry.hpp"
+#include "attr.hpp"
+#include "file.hpp"
+#include "filter.hpp"
+
+using namespace std;
+
+Filter::Filter(): min(0), max(numeric_limits<uint64_t>::max()),
+	from(numeric_limits<time_t>::min()), to(numeric_limits<time_t>::max()),
+	deleted(false), dirs(false), raw(false) {}
+
+Filter::operator bool() const
+{
+	return min || max != numeric_limits<uint64_t>::max()
+		|| from != numeric_limits<time_t>::min() || to != numeric_limits<time_t>::max()
+		|| !path.empty() || deleted || dirs || !include.empty() || !exclude.empty();
+}
+
+// first of entries the extension hits, as mime type (other entries checked) or as extension
+static bool first(const Context& context, const set<string>& entries, const string& ext, bool& next)
+{
+	for (const auto& extension: entries) {
+		auto hit = context.mime.find(extension);
+		if (hit != context.mime.end() && hit->second.count(ext)) {
+			next = true;
+			return true;
+		}
+		if (ext == extension) {
+			next = false;
+			return true;
+		}
+	}
+	return false;
+}
+
+/*
+ * extensions of -i/-x and their mime types to a lookup each, no mime lookups per entry
+ */
+void Filter::compile(const Context& context)
+{
+	include.clear();
+	exclude.clear();
+	for (auto* entries: { &context.include, &context.exclude })
+		for (const auto& extension: *entries) {
+			vector<string> exts{ extension };
+			auto mime = context.mime.find(extension);
+			if (mime != context.mime.end()) exts.insert(exts.end(), mime->second.begin(), mime->second.end());
+			for (const auto& ext: exts) {
+				bool next = false;
+				if (!first(context, *entries, ext, next)) continue;
+				if (entries == &context.include) include.emplace(ext, next);
+				else exclude.emplace(ext, true);
+			}
+		}
+	raw = *this && !context.all && context.store.empty();
+}
+
+// range as min,max, either may be left out, size with k, M or G suffix
+bool Filter::size(const string& range)
+{
+	auto parse = [](const string& text, uint64_t& size) {
+		if (text.empty()) return true;
+		size_t end = 0;
+		if (!isdigit((unsigned char)text[0])) return false;
+		try { size = stoull(text, &end, 10); }		// 010 is 10, not octal
+		catch (...) { return false; }
+		string unit = text.substr(end);
+		if (unit == "k" || unit == "K") size *= kB;
+		else if (unit == "M") size *= MB;
+		else if (unit == "G") size *= 1ULL << 30;
+		else if (!unit.empty()) return false;
+		return true;
+	};
+	size_t comma = range.find(',');
+	if (!parse(range.substr(0, comma), min)) return false;
+	if (comma != range.npos && !parse(range.substr(comma + 1), max)) return false;
+	return min <= max;
+}
+
+// range as from,to, local time yyyy.mm.dd[.hh[:mm[:ss]]], to excluded
+bool Filter::time(const string& range)
+{
+	auto parse = [](const string& text, time_t& time) {
+		if (text.empty()) return true;
+		struct tm tm = {};
+		int fields = sscanf(text.c_str(), "%d.%d.%d.%d:%d:%d",
+			&tm.tm_year, &tm.tm_mon, &tm.tm_mday, &tm.tm_hour, &tm.tm_min, &tm.tm_sec);
+		if (fields < 3) return false;
+		tm.tm_year -= 1900;
+		tm.tm_mon--;
+		tm.tm_isdst = -1;
+		time = mktime(&tm);
+		return time != -1;
+	};
+	size_t comma = range.find(',');
+	if (!parse(range.substr(0, comma), from)) return false;
+	if (comma != range.npos && !parse(range.substr(comma + 1), to)) return false;
+	return from <= to;
+}
+
+bool Filter::hit(string ext, bool valid) const
+{
+	if (!valid) return false;
+	lower(ext);
+	if (!include.empty()) {
+		auto hit = include.find(ext);
+		if (hit == include.end()) return false;
+		if (!hit->second) return true;				// hit as extension, no exclude checking
+	}
+	return !exclude.count(ext);
+}
+
+// size of files only, directories have index allocation size
+bool Filter::match(bool used, bool dir, uint64_t size, time_t time) const
+{
+	if (deleted && used) return false;
+	if (dirs && !dir) return false;
+	if (!dir && (size < min || size > max)) return false;
+	return time >= from && time < to;
+}
+
+bool Filter::match(const string& path, const string& name) const
+{
+	if (this->path.empty()) return true;
+	string full = path + name;
+	if (this->path.find_first_of("*?[") != string::npos) return !fnmatch(this->path.c_str(), full.c_str(), 0);
+	return !full.compare(0, this->path.size(), this->path);
+}
+
+bool Filter::match(const File& file) const
+{
+	return match(file.used, file.dir, file.size, time_t(file.time)) && match(file.path, file.name);
+}
+
+/*
+ * size and time from attribute headers, name of record only when extensions filtered
+ * a record File would accept is never rejected, $MFT record sets context and is always passed
+ */
+bool Filter::pass(const Record* record) const
+{
+	if (!raw || !record->rec) return true;
+	uint64_t size = 0;
+	time_t time = 0;
+	for (auto attr = reinterpret_cast<const Attr*>(record->key + record->attr); attr; attr = attr->getNext())
+		if (auto info = attr->getInfo()) time = convert(info->changeTime);
+		else if (auto data = attr->getData()) size = data->used & 0xFFFFFFFFFFFF;
+	if (!match(record->used(), record->dir(), size, time)) return false;
+	if (record->dir() || (include.empty() && exclude.empty())) return true;		// directories shown whatever extension
+	const Name* attr = record->getName();
+	if (!attr) return true;
+	string name = attr->getName();
+	if (name.empty()) return true;
+	size_t dot = name.rfind('.');
+	return hit(dot == name.npos? string(): name.substr(dot + 1), true);
+}
+
+ostream& operator<<(ostream& os, const Filter& filter) {
+	auto date = [&os](time_t time) {
+		struct tm tm;
+		if (localtime_r(&time, &tm)) os << put_time(&tm, "%Y.%m.%d %H:%M:%S");
+	};
+	if (filter.min || filter.max != numeric_limits<uint64_t>::max()) {
+		os << "size:" << dec << filter.min << '-';
+		if (filter.max != numeric_limits<uint64_t>::max()) os << filter.max;
+		os << ", ";
+	}
+	if (filter.from != numeric_limits<time_t>::min() || filter.to != numeric_limits<time_t>::max()) {
+		os << "time:";
+		if (filter.from != numeric_limits<time_t>::min()) date(filter.from);
+		os << " - ";
+		if (filter.to != numeric_limits<time_t>::max()) date(filter.to);
+		os << ", ";
+	}
+	if (!filter.path.empty()) os << "path:" << filter.path << ", ";
+	if (filter.deleted) os << "deleted only, ";
+	if (filter.dirs) os << "dirs only, ";
+	return os;
+}
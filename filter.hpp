@@ -0,0 +1,37 @@
+#pragma once
+
+#include <cstdint>
+#include <ctime>
+#include <string>
+#include <unordered_map>
+
+struct Context;
+struct Record;
+struct File;
+
+/*
+ * entry filter compiled from options: -i/-x extensions with mime types expanded, -z size, -T time, -P path,
+ * --deleted, --dirs; records not matching are rejected on raw record bytes before attributes are decoded,
+ * unless all entries are shown (-a) or catalogued (-C), path is matched when resolved
+ */
+struct Filter {
+	uint64_t	min, max;				// file size range, -z
+	time_t		from, to;				// modification time range, -T, to excluded
+	std::string	path;					// path prefix or glob, -P
+	bool		deleted, dirs;			// deleted entries only, directories only
+	bool		raw;					// records rejected before decoded
+	std::unordered_map<std::string, bool> include, exclude;	// extensions, include value: exclude checked too
+
+	Filter();
+	operator bool() const;				// anything to filter
+	void compile(const Context&);
+	bool size(const std::string&);		// range parsed, false if malformed
+	bool time(const std::string&);
+	bool hit(std::string, bool) const;	// extension included and not excluded, valid so far
+	bool match(bool, bool, uint64_t, time_t) const;	// used, dir, size, time
+	bool match(const std::string&, const std::string&) const;	// path and name
+	bool match(const File&) const;
+	bool pass(const Record*) const;		// record is not rejected
+};
+
+std::ostream& operator<<(std::ostream&, const Filter&);
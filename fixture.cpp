@@ -0,0 +1,150 @@
+#include <cstring>
+
+#include "fixture.hpp"
+
+using namespace std;
+
+static void put16(vector<uint8_t>& data, size_t offset, uint16_t value) { memcpy(&data[offset], &value, sizeof(value)); }
+static void put32(vector<uint8_t>& data, size_t offset, uint32_t value) { memcpy(&data[offset], &value, sizeof(value)); }
+static void put64(vector<uint8_t>& data, size_t offset, uint64_t value) { memcpy(&data[offset], &value, sizeof(value)); }
+
+Fixture::Fixture(uint32_t index, uint16_t flags): data(record), pos(0x38), id(0)
+{
+	memcpy(data.data(), "FILE", 4);
+	put16(data, 4, 0x30);			// update sequence offset and size
+	put16(data, 6, 3);
+	put16(data, 0x10, 1);			// sequence number, link count
+	put16(data, 0x12, 1);
+	put16(data, 0x14, pos);			// first attribute
+	put16(data, 0x16, flags);
+	put32(data, 0x1C, record);
+	put32(data, 0x2C, index);
+}
+
+uint64_t Fixture::time(uint64_t seconds) { return (seconds + epoch) * 10000000ULL; }
+
+size_t Fixture::resident(uint32_t type, const vector<uint8_t>& value)
+{
+	size_t size = (24 + value.size() + 7) & ~size_t(7);
+	put32(data, pos, type);
+	put32(data, pos + 4, size);
+	put16(data, pos + 14, id++);
+	put32(data, pos + 16, value.size());
+	put16(data, pos + 20, 24);
+	memcpy(&data[pos + 24], value.data(), value.size());
+	pos += size;
+	return pos;
+}
+
+void Fixture::nonres(uint32_t type, const vector<Extent>& extents, uint64_t size)
+{
+	auto list = runlist(extents);
+	uint64_t clusters = 0;
+	for (auto& extent: extents) clusters += extent.count;
+	size_t length = 64 + list.size();
+	put32(data, pos, type);
+	put32(data, pos + 4, length);
+	data[pos + 8] = 1;
+	put16(data, pos + 14, id++);
+	put64(data, pos + 16, 0);
+	put64(data, pos + 24, clusters? clusters - 1: 0);
+	put16(data, pos + 32, 64);
+	put64(data, pos + 40, clusters * cluster);
+	put64(data, pos + 48, size);
+	put64(data, pos + 56, size);
+	memcpy(&data[pos + 64], list.data(), list.size());
+	pos += length;
+}
+
+void Fixture::close(bool fixup)
+{
+	put32(data, pos, 0xFFFFFFFF);
+	pos += 8;
+	put32(data, 0x18, pos);
+	put16(data, 0x28, id);
+	if (!fixup) return;
+	put16(data, 0x30, 1);
+	for (size_t at = 0; at < record / sector; at++) {
+		memcpy(&data[0x32 + 2 * at], &data[sector * (at + 1) - 2], 2);
+		put16(data, sector * (at + 1) - 2, 1);
+	}
+}
+
+// runs with lcn offsets relative to previous run, sparse runs with no offset
+vector<uint8_t> Fixture::runlist(const vector<Extent>& extents)
+{
+	auto bytes = [](int64_t value, bool sign) {
+		int size = 1;
+		for (; size < 8; size++) {
+			int64_t low = sign? -(1LL << (8 * size - 1)): 0;
+			int64_t high = sign? (1LL << (8 * size - 1)) - 1: (1LL << (8 * size)) - 1;
+			if (value >= low && value <= high) break;
+		}
+		return size;
+	};
+	vector<uint8_t> list;
+	int64_t last = 0;
+	for (auto& extent: extents) {
+		int length = bytes(extent.count, false);
+		int64_t delta = extent.lcn - last;
+		int offset = extent.sparse? 0: bytes(delta, true);
+		list.push_back(length | offset << 4);
+		for (int i = 0; i < length; i++) list.push_back(extent.count >> 8 * i);
+		for (int i = 0; i < offset; i++) list.push_back(delta >> 8 * i);
+		if (!extent.sparse) last = extent.lcn;
+	}
+	list.push_back(0);
+	while (list.size() % 8) list.push_back(0);
+	return list;
+}
+
+vector<uint8_t> Fixture::info(uint64_t seconds)
+{
+	vector<uint8_t> value(72);
+	for (int i = 0; i < 4; i++) put64(value, 8 * i, time(seconds));
+	put32(value, 32, 0x20);			// archive
+	return value;
+}
+
+// win32 name space, ASCII name
+vector<uint8_t> Fixture::name(uint64_t parent, const string& name, uint64_t seconds, uint64_t size)
+{
+	vector<uint8_t> value(66 + 2 * name.size());
+	put64(value, 0, parent | 1ULL << 48);
+	for (int i = 0; i < 4; i++) put64(value, 8 + 8 * i, time(seconds));
+	put64(value, 40, (size + cluster - 1) & ~uint64_t(cluster - 1));
+	put64(value, 48, size);
+	value[64] = name.size();
+	value[65] = 1;
+	for (size_t i = 0; i < name.size(); i++) put16(value, 66 + 2 * i, (unsigned char)name[i]);
+	return value;
+}
+
+// $INDEX_ROOT of file names, as many nodes as fit in room
+vector<uint8_t> Fixture::root(const vector<Node>& nodes, size_t room)
+{
+	vector<uint8_t> value(32);
+	put32(value, 0, 0x30);
+	put32(value, 4, 1);
+	put32(value, 8, cluster);
+	value[12] = 1;
+	for (auto& node: nodes) {
+		auto key = name(node.parent, node.name, 0, 0);
+		size_t size = (16 + key.size() + 7) & ~size_t(7);
+		if (value.size() + size + 16 > room) break;
+		size_t at = value.size();
+		value.resize(at + size);
+		put64(value, at, node.index | 1ULL << 48);
+		put16(value, at + 8, size);
+		put16(value, at + 10, key.size());
+		memcpy(&value[at + 16], key.data(), key.size());
+	}
+	size_t at = value.size();
+	value.resize(at + 16);
+	put16(value, at + 8, 16);
+	value[at + 12] = 2;				// last node
+	put32(value, 16, 16);
+	put32(value, 20, value.size() - 16);
+	put32(value, 24, value.size() - 16);
+	return value;
+}
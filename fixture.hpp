@@ -0,0 +1,29 @@
+#pragma once
+
+#include <cstdint>
+#include <string>
+#include <vector>
+
+/*
+ * synthetic NTFS records, sector 512, cluster 4096, record 1024, for benchmarks, not part of ntfs.recover
+ * attributes are added in order and the record is closed with end marker and optional update sequence
+ */
+struct Fixture {
+	static const uint32_t sector = 512, cluster = 4096, record = 1024;
+	static const uint64_t epoch = 11644473600ULL;		// seconds from 1601 to 1970
+	struct Extent { uint64_t lcn, count; bool sparse; };
+	struct Node { uint64_t index, parent; std::string name; };
+	std::vector<uint8_t> data;
+	size_t		pos;					// next attribute offset
+	uint16_t	id;						// next attribute id
+
+	Fixture(uint32_t index, uint16_t flags);
+	size_t resident(uint32_t type, const std::vector<uint8_t>& value);
+	void nonres(uint32_t type, const std::vector<Extent>& extents, uint64_t size);
+	void close(bool fixup);
+	static uint64_t time(uint64_t seconds);			// unix seconds as NTFS time
+	static std::vector<uint8_t> runlist(const std::vector<Extent>&);
+	static std::vector<uint8_t> info(uint64_t time);
+	static std::vector<uint8_t> name(uint64_t parent, const std::string& name, uint64_t time, uint64_t size);
+	static std::vector<uint8_t> root(const std::vector<Node>& nodes, size_t room);
+};
@@ -1,5 +1,9 @@
 #include <iostream>
 #include <iomanip>
+#include <cstring>
+#ifdef __SSE2__
+#include <emmintrin.h>
+#endif
 
 #include "helper.hpp"
 #include "context.hpp"
@@ -46,10 +50,10 @@ bool pdump(const void* start, const void* end) {
     return ldump(start, length);
 }
 
-bool dump(LBA lba, const std::vector<char>& data) {
+bool dump(LBA lba, const void* data, size_t size) {
     if (!Context::debug) return false;
     cerr << "offset: " << outvar(lba) << endl;
-    return ldump(data.data(), (uint)data.size()); 
+    return ldump(data, (uint)size); 
 }
 
 string& lower(string& text) {
@@ -58,6 +62,74 @@ string& lower(string& text) {
     return text;
 }
 
+/*
+ * UTF-16LE to UTF-8, written to out with room for 3 bytes per unit, returns bytes written
+ * ASCII taken 8 units at a time, surrogate pairs as 4 bytes, unpaired surrogates as U+FFFD
+ */
+size_t utf8(const char16_t* in, size_t size, char* out) {
+    auto unit = [in](size_t i) { uint16_t data; memcpy(&data, in + i, sizeof(data)); return data; };    // names may be unaligned
+    char* start = out;
+    size_t i = 0;
+    while (i < size) {
+#ifdef __SSE2__
+        if (i + 8 <= size) {
+            __m128i units = _mm_loadu_si128(reinterpret_cast<const __m128i*>(in + i));
+            __m128i high = _mm_and_si128(units, _mm_set1_epi16(int16_t(0xFF80)));
+            if (_mm_movemask_epi8(_mm_cmpeq_epi16(high, _mm_setzero_si128())) == 0xFFFF) {
+                _mm_storel_epi64(reinterpret_cast<__m128i*>(out), _mm_packus_epi16(units, units));
+                out += 8;
+                i += 8;
+                continue;
+            }
+        }
+#endif
+        uint32_t code = unit(i++);
+        if (code < 0x80) {
+            *out++ = code;
+            continue;
+        }
+        if (code < 0x800) {
+            *out++ = 0xC0 | code >> 6;
+            *out++ = 0x80 | (code & 0x3F);
+            continue;
+        }
+        if (code >= 0xD800 && code < 0xE000) {
+            uint32_t low = i < size? unit(i): 0;
+            if (code < 0xDC00 && low >= 0xDC00 && low < 0xE000) {
+                code = 0x10000 + ((code - 0xD800) << 10) + (low - 0xDC00);
+                i++;
+                *out++ = 0xF0 | code >> 18;
+                *out++ = 0x80 | ((code >> 12) & 0x3F);
+                *out++ = 0x80 | ((code >> 6) & 0x3F);
+                *out++ = 0x80 | (code & 0x3F);
+                continue;
+            }
+            code = 0xFFFD;
+        }
+        *out++ = 0xE0 | code >> 12;
+        *out++ = 0x80 | ((code >> 6) & 0x3F);
+        *out++ = 0x80 | (code & 0x3F);
+    }
+    return out - start;
+}
+
+// text as JSON string content, quotes, backslashes and control characters escaped
+string escape(const string& text) {
+    string out;
+    out.reserve(text.size());
+    for (unsigned char c: text) {
+        if (c == '"' || c == '\\') out += '\\';
+        if (c >= 0x20) {
+            out += c;
+            continue;
+        }
+        char code[8];
+        snprintf(code, sizeof(code), "\\u%04X", c);
+        out += code;
+    }
+    return out;
+}
+
 void confirm(string&& info) {
     if (!Context::confirm) return;
     if (!info.empty()) cerr << tab << info << endl;
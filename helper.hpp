@@ -18,6 +18,8 @@ using LBA = uint64_t;
 
 bool ldump(const void*, uint, uint = 0);
 bool pdump(const void*, const void*);
-bool dump(LBA, const std::vector<char>&);
+bool dump(LBA, const void*, size_t);
 void confirm(std::string&& info = std::string());
 std::string& lower(std::string&);
+std::string escape(const std::string&);			// JSON string content
+size_t utf8(const char16_t*, size_t, char*);	// UTF-16 units to UTF-8, 3 bytes per unit room needed
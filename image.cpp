@@ -0,0 +1,262 @@
+#include <iostream>
+#include <fstream>
+#include <cstring>
+#include <string>
+#include <vector>
+#include <random>
+#include <fcntl.h>
+#include <unistd.h>
+
+#include "fixture.hpp"
+
+using namespace std;
+
+/*
+ * synthetic NTFS image, built with make bench, not part of ntfs.recover
+ * ./ntfs.image [Options]	raw image with boot sector, $MFT and its bitmap, system records, directory tree,
+ *	resident, nonresident, sparse and fragmented files of known content, deleted records
+ * manifest lists each file: index name used kind size hole-bytes FNV-1a hash of content
+ */
+
+static const uint32_t sector = Fixture::sector, cluster = Fixture::cluster, record = Fixture::record;
+
+struct Image {
+	int			fd;
+	uint64_t	bias;					// partition offset in bytes
+	uint64_t	next;					// next free cluster
+	mt19937_64	random;
+	Image(): fd(-1), bias(0), next(16) {}
+	void write(uint64_t lcn, const void* data, size_t size) {
+		if (pwrite(fd, data, size, bias + lcn * cluster) != ssize_t(size)) perror("write");
+	}
+	uint64_t alloc(uint64_t count) { uint64_t lcn = next; next += count; return lcn; }
+};
+
+static void put16(vector<uint8_t>& data, size_t offset, uint16_t value) { memcpy(&data[offset], &value, sizeof(value)); }
+static void put64(vector<uint8_t>& data, size_t offset, uint64_t value) { memcpy(&data[offset], &value, sizeof(value)); }
+
+// file content known from its index and offset, GEN and index at start
+static void content(vector<uint8_t>& data, uint64_t index, uint64_t from)
+{
+	for (size_t i = 0; i < data.size(); i++) data[i] = uint8_t((index * 131 + (from + i) * 7) >> 3);
+	if (!from && data.size() >= 8) {
+		memcpy(data.data(), "GEN\0", 4);
+		memcpy(data.data() + 4, &index, 4);
+	}
+}
+
+static void help(const char* name)
+{
+	cerr << name << R"EOF( [Options]
+
+Options:
+-o file	image to write, default ntfs.img
+-n N	$MFT records, default 4096
+-F N	$MFT fragments, default 1
+-D N	directory tree depth, default 3
+-W N	directory tree width, default 6
+-d N	percent of files and directories deleted, default 10
+-f N	most fragments of fragmented files, default 8
+-M N	largest file in kB, default 512
+-p N	partition offset in sectors, default 0
+-s N	random seed, default 1
+-z	no update sequence in records
+-m file	manifest of files written
+)EOF";
+}
+
+int main(int n, char** argv) {
+	string out = "ntfs.img", manifest;
+	uint64_t records = 4096, fragments = 1, depth = 3, width = 6, deleted = 10, pieces = 8, offset = 0, seed = 1, largest = 512;
+	bool fixup = true;
+	int option;
+	while ((option = getopt(n, argv, "o:n:F:D:W:d:f:p:s:M:zm:h")) != -1) switch (option) {
+		case 'o': out = optarg; break;
+		case 'n': records = stoull(optarg, nullptr, 0); break;
+		case 'F': fragments = max<uint64_t>(1, stoull(optarg, nullptr, 0)); break;
+		case 'D': depth = stoull(optarg, nullptr, 0); break;
+		case 'W': width = stoull(optarg, nullptr, 0); break;
+		case 'd': deleted = stoull(optarg, nullptr, 0); break;
+		case 'f': pieces = max<uint64_t>(1, stoull(optarg, nullptr, 0)); break;
+		case 'p': offset = stoull(optarg, nullptr, 0); break;
+		case 's': seed = stoull(optarg, nullptr, 0); break;
+		case 'M': largest = max<uint64_t>(1, stoull(optarg, nullptr, 0)); break;
+		case 'z': fixup = false; break;
+		case 'm': manifest = optarg; break;
+		default: help(argv[0]); return option == 'h'? EXIT_SUCCESS: EXIT_FAILURE;
+	}
+	records = max<uint64_t>(records, 16) & ~uint64_t(cluster / record - 1);
+	Image image;
+	image.random.seed(seed);
+	image.bias = offset * sector;
+	image.fd = open(out.c_str(), O_CREAT | O_TRUNC | O_WRONLY | O_CLOEXEC, 0644);
+	if (image.fd < 0) {
+		cerr << "Can not open image: " << out << ", error: " << strerror(errno) << endl;
+		return EXIT_FAILURE;
+	}
+
+	// $MFT extents, gaps between fragments
+	uint64_t clusters = records * record / cluster;
+	vector<Fixture::Extent> mft;
+	for (uint64_t fragment = 0, left = clusters; fragment < fragments; fragment++) {
+		uint64_t count = fragment + 1 == fragments? left: clusters / fragments;
+		mft.push_back({ image.alloc(count), count, false });
+		left -= count;
+		if (fragment + 1 < fragments) image.next += 64;
+	}
+	uint64_t bitmaps = (records / 8 + cluster - 1) / cluster;
+	vector<Fixture::Extent> bitmapRuns{ { image.alloc(bitmaps), bitmaps, false } };
+	vector<uint8_t> bitmap(bitmaps * cluster);
+
+	// directory tree of depth and width, the rest as flat files in bulk directories of root
+	struct Item { uint64_t index, parent; string name; bool dir, used; };
+	vector<Item> items;
+	vector<vector<Fixture::Node>> children(records);
+	uint64_t index = 16;
+	vector<uint64_t> level{ 5 };
+	for (uint64_t d = 0; d < depth && index < records; d++) {
+		vector<uint64_t> next;
+		for (auto parent: level)
+			for (uint64_t w = 0; w < width && index < records; w++) {
+				bool dir = d + 1 < depth && w < 2;
+				string name = (dir? "dir": "file") + to_string(index) + (dir? "": (index % 3? ".jpg": ".txt"));
+				items.push_back({ index, parent, name, dir, image.random() % 100 >= deleted });
+				children[parent].push_back({ index, parent, name });
+				if (dir) next.push_back(index);
+				index++;
+			}
+		level = next;
+	}
+	for (uint64_t dir = 5; index < records; index++) {
+		if (!(index & 255)) {
+			items.push_back({ index, 5, "bulk" + to_string(index), true, true });
+			children[5].push_back({ index, 5, items.back().name });
+			dir = index;
+			continue;
+		}
+		string name = "f" + to_string(index) + (index % 2? ".jpg": ".bin");
+		items.push_back({ index, dir, name, false, image.random() % 100 >= deleted });
+		children[dir].push_back({ index, dir, name });
+	}
+
+	// system records, 12 to 15 reserved
+	vector<Fixture> recs;
+	recs.reserve(records);
+	for (uint64_t i = 0; i < records; i++) recs.emplace_back(i, 0);
+	const char* system[] = { "$MFT", "$MFTMirr", "$LogFile", "$Volume", "$AttrDef", ".",
+		"$Bitmap", "$Boot", "$BadClus", "$Secure", "$UpCase", "$Extend" };
+	uint64_t start = 1672531200;		// 2023.01.01
+	for (uint64_t i = 0; i < 16; i++) {
+		if (i >= 12) continue;
+		Fixture& rec = recs[i] = Fixture(i, i == 5? 3: 1);
+		bitmap[i / 8] |= 1 << (i % 8);
+		rec.resident(0x10, Fixture::info(start));
+		rec.resident(0x30, Fixture::name(5, system[i], start, 0));
+		if (!i) {
+			rec.nonres(0x80, mft, records * record);
+			rec.nonres(0xB0, bitmapRuns, (records + 7) / 8);
+		}
+		else if (i == 5) rec.resident(0x90, Fixture::root(children[5], record - rec.pos - 64));
+		else rec.resident(0x80, {});
+	}
+
+	// files: 0 empty, 1 resident, 8 sparse, 9 fragmented, others contiguous
+	uint64_t bytes = 0;
+	ofstream list;
+	if (!manifest.empty()) list.open(manifest);
+	auto note = [&](const Item& item, uint64_t size, uint64_t hole, uint64_t holes, int kind) {
+		if (!list.is_open()) return;
+		vector<uint8_t> data(size);
+		content(data, item.index, 0);
+		if (holes) fill(data.begin() + hole, data.begin() + min(size, hole + holes), 0);
+		uint64_t hash = 14695981039346656037ULL;
+		for (auto c: data) hash = (hash ^ c) * 1099511628211ULL;
+		list << item.index << ' ' << item.name << ' ' << item.used << ' ' << kind << ' ' << size << ' ' << holes << ' ' << hash << '\n';
+	};
+	for (auto& item: items) {
+		Fixture& rec = recs[item.index] = Fixture(item.index, (item.used? 1: 0) | (item.dir? 2: 0));
+		if (item.used) bitmap[item.index / 8] |= 1 << (item.index % 8);
+		uint64_t time = start + item.index * 3600;
+		if (item.dir) {
+			rec.resident(0x10, Fixture::info(time));
+			rec.resident(0x30, Fixture::name(item.parent, item.name, time, 0));
+			rec.resident(0x90, Fixture::root(children[item.index], record - rec.pos - 64));
+			continue;
+		}
+		int kind = image.random() % 10;
+		uint64_t size = 0;
+		if (kind == 1) size = 1 + image.random() % 400;
+		else if (kind) size = 1 + image.random() % (largest * 1024);
+		rec.resident(0x10, Fixture::info(time));
+		rec.resident(0x30, Fixture::name(item.parent, item.name, time, size));
+		if (kind < 2) {
+			vector<uint8_t> data(size);
+			content(data, item.index, 0);
+			rec.resident(0x80, data);
+			note(item, size, 0, 0, kind);
+			continue;
+		}
+		uint64_t count = (size + cluster - 1) / cluster;
+		uint64_t parts = kind == 9? min<uint64_t>(count, 1 + image.random() % pieces): 1;
+		vector<Fixture::Extent> runs;
+		for (uint64_t part = 0, done = 0; part < parts; part++) {
+			uint64_t length = part + 1 == parts? count - done: max<uint64_t>(1, count / parts);
+			runs.push_back({ image.alloc(length), length, false });
+			done += length;
+			image.next += image.random() % 4;
+		}
+		bool sparse = kind == 8 && count > 2;
+		if (sparse) {			// middle cluster becomes a hole
+			uint64_t hole = count / 2;
+			Fixture::Extent run = runs[0];
+			runs = { { run.lcn, hole, false }, { 0, 1, true } };
+			if (count - hole - 1) runs.push_back({ run.lcn + hole + 1, count - hole - 1, false });
+		}
+		uint64_t vcn = 0;
+		for (auto& run: runs) {
+			if (!run.sparse) {
+				vector<uint8_t> data(run.count * cluster);
+				content(data, item.index, vcn * cluster);
+				if (vcn * cluster + data.size() > size) fill(data.begin() + (size - vcn * cluster), data.end(), 0);
+				image.write(run.lcn, data.data(), data.size());
+			}
+			vcn += run.count;
+		}
+		bytes += size;
+		note(item, size, sparse? count / 2 * cluster: 0, sparse? cluster: 0, kind);
+		rec.nonres(0x80, runs, size);
+	}
+
+	// records in $MFT extents order
+	uint64_t rec = 0;
+	for (auto& run: mft)
+		for (uint64_t i = 0; i < run.count * cluster / record; i++, rec++) {
+			recs[rec].close(fixup);
+			if (pwrite(image.fd, recs[rec].data.data(), record, image.bias + run.lcn * cluster + i * record) < 0) perror("write");
+		}
+	image.write(bitmapRuns[0].lcn, bitmap.data(), bitmap.size());
+
+	// boot sector
+	uint64_t total = (image.next + 16) * cluster / sector;
+	vector<uint8_t> boot(sector);
+	boot[0] = 0xEB;
+	boot[1] = 0x52;
+	boot[2] = 0x90;
+	memcpy(&boot[3], "NTFS    ", 8);
+	put16(boot, 0x0B, sector);
+	boot[0x0D] = cluster / sector;
+	boot[0x15] = 0xF8;
+	put64(boot, 0x28, total - 1);
+	put64(boot, 0x30, mft[0].lcn);
+	put64(boot, 0x38, 2);
+	boot[0x40] = 0xF6;				// record size 2^10
+	boot[0x44] = 1;
+	put64(boot, 0x48, 0x1234567890ABCDEFULL);
+	put16(boot, 510, 0xAA55);
+	if (pwrite(image.fd, boot.data(), sector, image.bias) < 0) perror("write");
+	if (ftruncate(image.fd, image.bias + total * sector)) perror("truncate");
+	close(image.fd);
+	cerr << out << ": records:" << records << ", mft:" << mft[0].lcn << '/' << mft.size()
+		<< ", clusters:" << image.next << ", data:" << bytes << endl;
+	return EXIT_SUCCESS;
+}
@@ -0,0 +1,123 @@
+#include "helper.hpp"
+#include "context.hpp"
+#include "entry.hpp"
+#include "file.hpp"
+#include "scan.hpp"
+#include "parser.hpp"
+#include "recovery.hpp"
+
+using namespace std;
+
+static const size_t batch = 1024;		// records in a batch
+static const size_t chunk = 16;			// records taken by a thread at once
+
+Parser::Parser(Context& context): context(context),
+	reading(batches), parsing(nullptr), next(0), done(0), stop(false)
+{
+	if (context.jobs < 2 || Context::verbose || Context::confirm) return;		// records shown while parsed
+	for (size_t i = 0; i < context.jobs; i++) threads.emplace_back(&Parser::run, this);
+}
+
+Parser::~Parser() {
+	{
+		lock_guard<mutex> guard(lock);
+		stop = true;
+	}
+	work.notify_all();
+	for (auto& thread: threads) thread.join();
+}
+
+void Parser::run()
+{
+	unique_lock<mutex> guard(lock);
+	while (true) {
+		work.wait(guard, [this] { return stop || (parsing && next < parsing->items.size()); });
+		if (stop) return;
+		Batch* batch = parsing;
+		size_t first = next;
+		next = min(next + chunk, batch->items.size());
+		size_t last = next;
+		guard.unlock();
+		auto begin = Stats::Clock::now();
+		for (size_t i = first; i < last; i++) {
+			Item& item = batch->items[i];
+			const Record* record = reinterpret_cast<const Record*>(batch->data.data() + item.offset);
+			item.file = new File(item.lba, record, context);
+		}
+		Context::stats.add(Stats::Parse, begin);
+		guard.lock();
+		done += last - first;
+		if (done == batch->items.size()) idle.notify_all();
+	}
+}
+
+// a boot sector or shown INDX block changes context or output while read
+void Parser::check(Scan& scan)
+{
+	const char* data = scan.fill(context.sector);
+	if (!data) return;
+	const Boot* boot = reinterpret_cast<const Boot*>(data);
+	const Index* index = reinterpret_cast<const Index*>(data);
+	if (*boot || (*index && context.index && !context.recover)) flush();
+}
+
+bool Parser::push(LBA lba, const Entry& entry)
+{
+	const Record* record = entry.record();
+	if (!record->rec || (!context.mft.first && !context.mft.last)) {		// $MFT record or bias to be set
+		flush();
+		return false;
+	}
+	if (!*this) return false;
+	reading->items.push_back({lba, reading->data.size(), nullptr});
+	reading->data.insert(reading->data.end(), entry.data(), entry.data() + entry.size());
+	if (reading->items.size() < batch) return true;
+	finish();
+	start(reading);
+	reading = reading == batches? batches + 1: batches;
+	return true;
+}
+
+// parse and recover all records queued, before context changes
+void Parser::flush()
+{
+	if (*this) {
+		finish();
+		start(reading);
+		reading = reading == batches? batches + 1: batches;
+		finish();
+	}
+	context.recovery->flush();
+}
+
+void Parser::start(Batch* batch)
+{
+	if (batch->items.empty()) return;
+	{
+		lock_guard<mutex> guard(lock);
+		parsing = batch;
+		next = done = 0;
+	}
+	work.notify_all();
+}
+
+/*
+ * wait for batch being parsed, queue its files for recovery in scan order
+ */
+void Parser::finish()
+{
+	if (!parsing) return;
+	unique_lock<mutex> guard(lock);
+	if (done < parsing->items.size()) {
+		Stats::add(Context::stats.waits);
+		auto begin = Stats::Clock::now();
+		idle.wait(guard, [this] { return done == parsing->items.size(); });
+		Context::stats.add(Stats::Wait, begin);
+	}
+	Batch* batch = parsing;
+	parsing = nullptr;
+	guard.unlock();
+	for (auto& item: batch->items) context.recovery->push(item.file);
+	batch->items.clear();
+	batch->data.clear();
+}
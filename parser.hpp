@@ -0,0 +1,53 @@
+#pragma once
+
+#include <cstdint>
+#include <vector>
+#include <thread>
+#include <mutex>
+#include <condition_variable>
+
+using LBA = uint64_t;
+
+struct Context;
+struct Entry;
+struct File;
+struct Scan;
+
+/*
+ * record parsing stage, scanned records are copied to a batch parsed into files by a thread pool
+ * while the next batch is read, files are queued for recovery in scan order by the reading thread
+ * records changing context (boot sector, $MFT record, records before $MFT is known) are barriers,
+ * batches and recovery are done before such a record is read and parsed in place
+ */
+struct Parser {
+	struct Item {
+		LBA			lba;
+		size_t		offset;				// record data in batch
+		File*		file;
+	};
+	struct Batch {
+		std::vector<char>	data;
+		std::vector<Item>	items;
+	};
+	Context&	context;
+	std::vector<std::thread> threads;
+	std::mutex	lock;
+	std::condition_variable work, idle;
+	Batch		batches[2];
+	Batch*		reading;				// batch filled by scan
+	Batch*		parsing;				// batch parsed by threads, nullptr if none
+	size_t		next;					// next item to parse
+	size_t		done;					// items parsed
+	bool		stop;
+
+	Parser(Context&);
+	~Parser();
+	operator bool() const { return !threads.empty(); }
+	void check(Scan&);					// finish batches before a barrier sector is read
+	bool push(LBA, const Entry&);		// false if record is to be parsed in place
+	void flush();						// parse and recover all records queued
+	private:
+	void run();
+	void start(Batch*);
+	void finish();
+};
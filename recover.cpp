@@ -1,11 +1,17 @@
 #include <iostream>
 #include <cstring>
-#include <sys/wait.h>
 
 #include "helper.hpp"
 #include "context.hpp"
 #include "entry.hpp"
 #include "file.hpp"
+#include "scan.hpp"
+#include "device.hpp"
+#include "parser.hpp"
+#include "recovery.hpp"
+#include "catalogue.hpp"
+#include "checkpoint.hpp"
+#include "writer.hpp"
 
 using namespace std;
 using namespace filesystem;
@@ -15,36 +21,76 @@ int main(int n, char** argv) {
 	Context context;
 	context.parse(n, argv);
 
-	ifstream idev(context.dev, ios::in | ios::binary);
-	if (!idev.is_open()) {
+	Device device(context.dev, context.direct);
+	Scan idev(device, context);
+	if (!device) {
 		cerr << "Can not open device: " << context.dev << endl
 			<< "Error: " << strerror(errno) << endl;
 		exit(EXIT_FAILURE);
 	}
 
+	context.device = &device;
+	File::dirs.clear(device.size / context.sector);		// records fit on device until $MFT is found
+
 	LBA lba = context.first;
-	if (!idev.seekg(lba * context.sector)) {
-		cerr << "Seek error: " << context.dev << endl
-			<< "Error: " << strerror(errno) << endl;
-		exit(EXIT_FAILURE);
+	Checkpoint checkpoint(context);
+	if (!context.checkfile.empty()) {
+		if (!checkpoint || (context.resume && !checkpoint.load(lba))) exit(EXIT_FAILURE);
+		context.checkpoint = &checkpoint;
 	}
+	idev.seek(lba);
 
+	Writer writer(context);
+	if (writer) context.writer = &writer;
+
+	Recovery recovery(context);
+	context.recovery = &recovery;
+	Catalogue catalogue(context);
+	if (!context.store.empty() || !context.query.empty()) {
+		if (!catalogue) exit(EXIT_FAILURE);
+		context.catalogue = &catalogue;
+	}
+	if (!context.query.empty()) {
+		cerr << "Recovering from catalogue entries...\n" << endl;
+		catalogue.query(recovery);
+		cerr << catalogue;
+		if (context.status) cerr << context.stats;
+		if (!context.summary.empty()) context.stats.save(context.summary, context);
+		return 0;
+	}
+	Parser parser(context);
 	cerr << "Searching for MFT entries...\n" << endl;
 	// scan for NTFS boot sector and MFT entries
 	while (idev) {
-		lba = idev.tellg() / context.sector;
+		if (context.stats.due()) cerr << context.stats;
+		auto begin = Stats::Clock::now();
+		idev.pass();
+		lba = idev.tell();
+		if (checkpoint.due()) {		// all records before scan position done
+			parser.flush();
+			checkpoint.save(lba);
+		}
 		if (context.stop(lba)) break;
+		parser.check(idev);
 		Entry entry(context);
 		idev >> entry;
-		if (!entry) continue;
-		File file(lba, entry.record(), context);
-		file.recover();
-		waitpid(-1, NULL, WNOHANG);
+		context.stats.add(Stats::Scan, begin);
+		if (!entry) {
+			if (!entry.empty() && *entry.record()) Stats::add(context.stats.rejected);		// FILE record failed checks
+			continue;
+		}
+		Stats::add(context.stats.valid);
+		if (parser.push(lba, entry)) continue;		// parsed in batch
+		begin = Stats::Clock::now();
+		File* file = new File(lba, entry.record(), context);
+		context.stats.add(Stats::Parse, begin);
+		recovery.push(file);
 	}
+	parser.flush();
+	if (checkpoint) checkpoint.save(idev.tell());
 
-	idev.close();
-	cerr << "\nWait for child processes... " << endl;
-	int id;
-	while (id = wait(NULL), id > -1) cerr << "pid " << id << " done, ";
+	cerr << idev << catalogue;
+	if (context.status) cerr << context.stats;
+	if (!context.summary.empty()) context.stats.save(context.summary, context);
 	return 0;
 }
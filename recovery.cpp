@@ -0,0 +1,110 @@
+#include "helper.hpp"
+#include "context.hpp"
+#include "file.hpp"
+#include "recovery.hpp"
+#include "catalogue.hpp"
+#include "writer.hpp"
+
+using namespace std;
+
+Recovery::Recovery(Context& context): context(context), limit(64 * context.workers), stop(false)
+{
+	if (Context::confirm) return;		// files confirmed one by one
+	for (size_t i = 0; i < context.workers; i++) threads.emplace_back(&Recovery::run, this);
+}
+
+Recovery::~Recovery() {
+	{
+		lock_guard<mutex> guard(lock);
+		stop = true;
+	}
+	work.notify_all();
+	for (auto& thread: threads) thread.join();
+}
+
+void Recovery::run()
+{
+	unique_lock<mutex> guard(lock);
+	while (true) {
+		work.wait(guard, [this] { return stop || !jobs.empty(); });
+		if (jobs.empty()) return;
+		Job* job = jobs.front();
+		jobs.pop_front();
+		guard.unlock();
+		auto begin = Stats::Clock::now();
+		job->file->copy();
+		Context::stats.add(Stats::Recover, begin);
+		guard.lock();
+		job->ready = true;
+		ready.notify_one();
+	}
+}
+
+void Recovery::push(File* file)
+{
+	if (context.catalogue) context.catalogue->add(*file);
+	if (!context.shared.show) {		// -s entries processed, files parsed in the same batch are not recovered
+		delete file;
+		return;
+	}
+	if (!*this) {
+		auto begin = Stats::Clock::now();
+		file->recover();
+		Context::stats.add(Stats::Recover, begin);
+		delete file;
+		return;
+	}
+	bool pending = file->pending();
+	if (!pending) file->copy();
+	unique_lock<mutex> guard(lock);
+	if (pending && context.shared.show > 0 && order.size() >= (size_t)context.shared.show) {
+		show(guard, 0);			// files queued may take all -s entries left, not copied before they are shown
+		if (!context.shared.show) {
+			guard.unlock();
+			delete file;
+			return;
+		}
+	}
+	show(guard, limit - 1);
+	order.push_back({file, !pending});
+	if (pending) {
+		jobs.push_back(&order.back());
+		work.notify_one();
+	}
+	show(guard, limit);
+}
+
+void Recovery::flush()
+{
+	if (!*this) return;
+	unique_lock<mutex> guard(lock);
+	show(guard, 0);
+}
+
+void Recovery::show(unique_lock<mutex>& guard, size_t keep)
+{
+	while (true) {
+		while (!order.empty() && order.front().ready) {
+			done.push_back(order.front().file);
+			order.pop_front();
+		}
+		if (!done.empty()) {
+			guard.unlock();
+			for (auto file: done) {
+				if (context.shared.show) {		// limit of entries to process not reached
+					if (context.writer) context.writer->add(*file);
+					else cout << *file;
+				}
+				delete file;
+			}
+			done.clear();
+			guard.lock();
+			continue;
+		}
+		if (order.size() <= keep) return;
+		Stats::add(Context::stats.waits);
+		auto begin = Stats::Clock::now();
+		ready.wait(guard);
+		Context::stats.add(Stats::Wait, begin);
+	}
+}
@@ -0,0 +1,40 @@
+#pragma once
+
+#include <deque>
+#include <vector>
+#include <thread>
+#include <mutex>
+#include <condition_variable>
+
+struct Context;
+struct File;
+
+/*
+ * file recovery threads, -p of them, files are read and written in parallel
+ * files are queued in scan order and shown in that order when done, queue is bounded
+ * files need no device read are shown as soon as all before them are
+ */
+struct Recovery {
+	struct Job {
+		File*	file;
+		bool	ready;
+	};
+	Context&	context;
+	std::vector<std::thread> threads;
+	std::mutex	lock;
+	std::condition_variable work, ready;
+	std::deque<Job>		order;			// files in scan order to show
+	std::deque<Job*>	jobs;			// files to copy
+	std::vector<File*>	done;			// files taken to show, reused
+	size_t		limit;					// max. files queued
+	bool		stop;
+
+	Recovery(Context&);
+	~Recovery();
+	operator bool() const { return !threads.empty(); }
+	void push(File*);					// recover file, taken over
+	void flush();						// wait for all files queued and show them
+	private:
+	void run();
+	void show(std::unique_lock<std::mutex>&, size_t);	// show files done, while more queued than given
+};
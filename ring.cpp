@@ -0,0 +1,98 @@
+#include <cstring>
+#include <cerrno>
+#include <unistd.h>
+#include <sys/mman.h>
+#include <sys/syscall.h>
+#include <linux/io_uring.h>
+
+#include "ring.hpp"
+
+Ring::Ring(unsigned entries): fd(-1), entries(entries), sqes(nullptr), sq(MAP_FAILED), cq(MAP_FAILED)
+{
+	if (entries < 2) return;
+	io_uring_params params;
+	memset(&params, 0, sizeof(params));
+	int ring = syscall(__NR_io_uring_setup, entries, &params);
+	if (ring < 0) return;
+
+	sqSize = params.sq_off.array + params.sq_entries * sizeof(unsigned);
+	cqSize = params.cq_off.cqes + params.cq_entries * sizeof(io_uring_cqe);
+	bool single = params.features & IORING_FEAT_SINGLE_MMAP;
+	if (single && cqSize > sqSize) sqSize = cqSize;
+	sq = mmap(nullptr, sqSize, PROT_READ | PROT_WRITE, MAP_SHARED | MAP_POPULATE, ring, IORING_OFF_SQ_RING);
+	if (sq == MAP_FAILED) {
+		close(ring);
+		return;
+	}
+	cq = single? sq: mmap(nullptr, cqSize, PROT_READ | PROT_WRITE, MAP_SHARED | MAP_POPULATE, ring, IORING_OFF_CQ_RING);
+	void* sqe = mmap(nullptr, params.sq_entries * sizeof(io_uring_sqe), PROT_READ | PROT_WRITE,
+			MAP_SHARED | MAP_POPULATE, ring, IORING_OFF_SQES);
+	if (cq == MAP_FAILED || sqe == MAP_FAILED) {
+		if (sqe != MAP_FAILED) munmap(sqe, params.sq_entries * sizeof(io_uring_sqe));
+		if (cq != MAP_FAILED && !single) munmap(cq, cqSize);
+		munmap(sq, sqSize);
+		sq = cq = MAP_FAILED;
+		close(ring);
+		return;
+	}
+
+	char* base = static_cast<char*>(sq);
+	sqHead = reinterpret_cast<unsigned*>(base + params.sq_off.head);
+	sqTail = reinterpret_cast<unsigned*>(base + params.sq_off.tail);
+	sqMask = reinterpret_cast<unsigned*>(base + params.sq_off.ring_mask);
+	sqArray = reinterpret_cast<unsigned*>(base + params.sq_off.array);
+	base = static_cast<char*>(cq);
+	cqHead = reinterpret_cast<unsigned*>(base + params.cq_off.head);
+	cqTail = reinterpret_cast<unsigned*>(base + params.cq_off.tail);
+	cqMask = reinterpret_cast<unsigned*>(base + params.cq_off.ring_mask);
+	cqes = reinterpret_cast<io_uring_cqe*>(base + params.cq_off.cqes);
+	sqes = static_cast<io_uring_sqe*>(sqe);
+	this->entries = params.sq_entries;
+	fd = ring;
+}
+
+Ring::~Ring() {
+	if (fd < 0) return;
+	munmap(sqes, entries * sizeof(io_uring_sqe));
+	if (cq != sq) munmap(cq, cqSize);
+	munmap(sq, sqSize);
+	close(fd);
+}
+
+bool Ring::read(int device, void* buffer, unsigned size, uint64_t offset, uint64_t tag)
+{
+	unsigned tail = *sqTail;
+	if (tail - __atomic_load_n(sqHead, __ATOMIC_ACQUIRE) >= entries) return false;
+	unsigned index = tail & *sqMask;
+	io_uring_sqe* sqe = sqes + index;
+	memset(sqe, 0, sizeof(*sqe));
+	sqe->opcode = IORING_OP_READ;
+	sqe->fd = device;
+	sqe->addr = reinterpret_cast<uint64_t>(buffer);
+	sqe->len = size;
+	sqe->off = offset;
+	sqe->user_data = tag;
+	sqArray[index] = index;
+	__atomic_store_n(sqTail, tail + 1, __ATOMIC_RELEASE);
+	return true;
+}
+
+bool Ring::submit(unsigned wait)
+{
+	unsigned pending = *sqTail - __atomic_load_n(sqHead, __ATOMIC_ACQUIRE);
+	int done;
+	do done = syscall(__NR_io_uring_enter, fd, pending, wait, wait? IORING_ENTER_GETEVENTS: 0, nullptr, 0);
+	while (done < 0 && errno == EINTR);
+	return done >= 0;
+}
+
+bool Ring::reap(uint64_t& tag, int& result)
+{
+	unsigned head = *cqHead;
+	if (head == __atomic_load_n(cqTail, __ATOMIC_ACQUIRE)) return false;
+	io_uring_cqe* cqe = cqes + (head & *cqMask);
+	tag = cqe->user_data;
+	result = cqe->res;
+	__atomic_store_n(cqHead, head + 1, __ATOMIC_RELEASE);
+	return true;
+}
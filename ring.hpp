@@ -0,0 +1,29 @@
+#pragma once
+
+#include <cstdint>
+#include <cstddef>
+
+struct io_uring_sqe;
+struct io_uring_cqe;
+
+/*
+ * minimal io_uring read queue on raw system calls, no liburing dependency
+ * reads are queued with a tag returned on completion
+ */
+struct Ring {
+	int			fd;
+	unsigned	entries;
+	unsigned	*sqHead, *sqTail, *sqMask, *sqArray;
+	unsigned	*cqHead, *cqTail, *cqMask;
+	io_uring_sqe*	sqes;
+	io_uring_cqe*	cqes;
+	void		*sq, *cq;
+	size_t		sqSize, cqSize;
+
+	Ring(unsigned);
+	~Ring();
+	operator bool() const { return fd >= 0; }
+	bool read(int, void*, unsigned, uint64_t, uint64_t);	// queue read of device fd into buffer at offset
+	bool submit(unsigned wait = 0);							// submit queued, wait for completions
+	bool reap(uint64_t& tag, int& result);					// take completed read if any
+};
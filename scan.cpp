@@ -0,0 +1,313 @@
+#include <cstring>
+#include <iomanip>
+#include <unistd.h>
+#include <sys/mman.h>
+
+#include "helper.hpp"
+#include "context.hpp"
+#include "device.hpp"
+#include "scan.hpp"
+#include "ring.hpp"
+
+using namespace std;
+
+Scan::Scan(const Device& device, Context& context): device(device), context(context),
+	base(nullptr), pos(0), end(0), offset(0), origin(0), done(0), unused(0), ahead(0), eof(false),
+	ring(nullptr), slot(0), held(false), next(0), search{}, mark(0), marked(0)
+{
+	start = progress.shown = chrono::steady_clock::now();
+	progress.from = UINT64_MAX;
+	progress.scanned = 0;
+	progress.speed = 0;
+	if (context.queue > 1) {
+		ring = new Ring(context.queue);
+		if (!*ring) {
+			cerr << "Can not setup io_uring, error: " << strerror(errno) << ". Reading synchronously" << endl;
+			delete ring;
+			ring = nullptr;
+		}
+	}
+	if (!ring && device.mapped()) return;
+	slots.resize(ring? context.queue: 1);
+	for (auto& slot: slots) {
+		slot.buffer.reserve(device, head + context.window * MB);
+		slot.busy = false;
+	}
+}
+
+Scan::~Scan() {
+	if (!ring) return;
+	for (auto& slot: slots) while (slot.busy) wait();
+	delete ring;
+}
+
+// device end reached, a tail shorter than a sector is not scanned
+Scan::operator bool() const { return device && !(eof && (pos >= end || end - pos < context.sector)); }
+
+LBA Scan::tell() const { return (offset + pos) / context.sector; }
+
+bool Scan::seek(LBA lba) {
+	done = scanned();
+	origin = lba * context.sector;
+	if (slots.empty()) {			// whole mapped image is the window
+		base = device.map;
+		offset = 0;
+		pos = ahead = origin;
+		end = device.size;
+		eof = true;
+		return device;
+	}
+	if (ring) for (auto& slot: slots) while (slot.busy) wait();
+	base = nullptr;
+	offset = next = device.align(origin);
+	pos = end = 0;
+	eof = held = false;
+	slot = slots.size() - 1;
+	size_t lead = origin - next;	// reads start at device block boundary
+	if (ring) for (size_t i = 0; i < slots.size(); i++) enqueue(i);
+	if (lead && dequeue(lead)) pos += lead;
+	return device;
+}
+
+/*
+ * return pointer to size bytes of data at current position, nullptr at device end
+ * or if size does not fit in room for carried over data before slot window
+ */
+const char* Scan::fill(size_t size)
+{
+	if (pos <= end && end - pos >= size) {
+		if (slots.empty() && pos >= ahead) advise();
+		return base + pos;
+	}
+	if (slots.empty() || size > head) return nullptr;
+	return dequeue(size);
+}
+
+/*
+ * move to next slot with data left in current one carried over to its front
+ * queued slot is waited for, synchronous one is read now
+ * slot done is queued to read the next window
+ */
+const char* Scan::dequeue(size_t size)
+{
+	size_t window = context.window * MB;
+	while (end - pos < size) {
+		if (eof) return nullptr;
+		size_t carry = end - pos;
+		size_t last = slot;
+		slot = (slot + 1) % slots.size();
+		Slot& ready = slots[slot];
+		char* data = ready.buffer.data + head;
+		if (ring) {
+			while (ready.busy) wait();
+			if (ready.result >= 0 && (size_t)ready.result < window) load(ready, ready.result);		// short read rest
+			if (carry) memcpy(data - carry, base + pos, carry);
+		}
+		else {
+			if (carry) memmove(data - carry, base + pos, carry);
+			ready.offset = next;
+			load(ready, 0);
+			if (ready.result > 0) next += ready.result;
+		}
+		if (ready.result < 0) {
+			cerr << endl << "Device read error @" << hex << uppercase << ready.offset / context.sector
+				<< ", error: " << strerror(-ready.result) << endl;
+			exit(EXIT_FAILURE);
+		}
+		base = data - carry;
+		offset = ready.offset - carry;
+		pos = 0;
+		end = carry + ready.result;
+		if ((size_t)ready.result < window) eof = true;
+		if (ring && held && !eof) enqueue(last);
+		held = true;
+	}
+	return base + pos;
+}
+
+void Scan::enqueue(size_t index) {
+	Slot& slot = slots[index];
+	slot.offset = next;
+	slot.busy = ring->read(device.fd, slot.buffer.data + head, context.window * MB, next, index);
+	next += context.window * MB;
+	if (slot.busy) ring->submit();
+	else load(slot, 0);				// submission queue full, read now
+}
+
+/*
+ * read rest of slot window after from bytes synchronously, short at device end only
+ * result is bytes in window or -errno
+ */
+void Scan::load(Slot& slot, size_t from)
+{
+	size_t window = context.window * MB;
+	char* data = slot.buffer.data + head;
+	while (from < window) {
+		ssize_t got = pread(device.fd, data + from, window - from, slot.offset + from);
+		int error = errno;
+		Context::stats.read(slot.offset + from, got);
+		if (got < 0 && error == EINTR) continue;
+		if (got < 0) {
+			slot.result = -error;
+			return;
+		}
+		if (!got) break;
+		from += got;
+	}
+	slot.result = from;
+}
+
+void Scan::wait() {
+	uint64_t tag;
+	int result;
+	ring->submit(1);
+	while (ring->reap(tag, result)) {
+		slots[tag].result = result;
+		Context::stats.read(slots[tag].offset, result);
+		slots[tag].busy = false;
+	}
+}
+
+/*
+ * move over sectors with no NTFS boot sector, FILE record or INDX signature
+ * sectors passed are counted as scanned entries, bitmap of candidates is searched a window at a time
+ * guided scan passes within current $MFT extent only
+ */
+void Scan::pass()
+{
+	follow();
+	if (context.all && context.verbose) return;		// every sector is shown
+	auto& count = context.shared.count;
+	uint64_t limit = bound();
+	while (count) {
+		uint64_t at = offset + pos;
+		if (at >= limit) {
+			follow();
+			limit = bound();
+			continue;
+		}
+		uint32_t sector = context.sector;
+		if (sector != search.sector || context.mft.size != search.mft
+				|| at < mark || at >= mark + marked * sector) {
+			const char* data = fill(sector);
+			if (!data) return;
+			at = offset + pos;
+			if (context.progress && !context.verbose) report();		// a window at a time, verbose lines are not cleaned
+			search.sector = sector;
+			search.mft = context.mft.size;
+			search.tag = !context.verbose;
+			search.index = context.index && !context.recover;
+			size_t length = min({end - pos, context.window * MB, limit - at});
+			mark = at;
+			marked = length / sector;
+			hits.resize((marked + 63) / 64);
+			search(data, length, hits.data());
+		}
+		size_t first = (at - mark) / sector, hit = first;
+		size_t word = hit / 64;
+		uint64_t bits = word < hits.size()? hits[word] & (~0ULL << (hit % 64)): 0;
+		while (!bits && ++word < hits.size()) bits = hits[word];
+		hit = bits? word * 64 + __builtin_ctzll(bits): marked;
+		if (hit > marked) hit = marked;
+		size_t skipped = hit - first;
+		if (count > 0 && skipped > (size_t)count) skipped = count;
+		if (count > 0) count -= skipped;
+		pos += skipped * sector;
+		if (hit == marked) continue;
+		if (context.undel || context.all || context.catalogue || !context.unused(tell())) return;
+		// record marked free in mft bitmap, not read unless catalogued
+		size_t size = max(context.mft.size, sector);
+		if (!fill(size)) return;
+		skip(size);
+		unused++;
+		if (count > 0) count--;
+	}
+}
+
+// device offset of guided scan current $MFT extent end
+uint64_t Scan::bound() const
+{
+	auto& mft = context.mft;
+	if (!context.guided || !mft.extent || mft.extent > mft.extents.size()) return UINT64_MAX;
+	return mft.extents[mft.extent - 1].second * context.sector;
+}
+
+/*
+ * once $MFT extents are known scan goes through them in record order, a seek to each
+ * when all are done the scan moves past the volume to look for another one
+ */
+void Scan::follow()
+{
+	auto& mft = context.mft;
+	if (!context.guided || mft.extents.empty() || mft.extent > mft.extents.size()) return;
+	LBA lba = tell();
+	auto inside = [&](size_t i) { return lba >= mft.extents[i].first && lba < mft.extents[i].second; };
+	if (!mft.extent)		// extents just found, continue in the one holding current position if any
+		for (size_t i = 0; i < mft.extents.size() && !mft.extent; i++)
+			if (inside(i)) mft.extent = i + 1;
+	while (!mft.extent || !inside(mft.extent - 1)) {
+		if (mft.extent == mft.extents.size()) {
+			mft.extent++;				// all done, extents kept for record lookups
+			if (context.volume > lba) seek(context.volume);
+			return;
+		}
+		seek(mft.extents[mft.extent++].first);
+		lba = tell();
+	}
+}
+
+// read next window of mapped device ahead, drop the one already scanned
+void Scan::advise() {
+	size_t window = context.window * MB;
+	device.advise(pos, window, MADV_WILLNEED);
+	if (pos < device.size) Context::stats.read(pos, min<uint64_t>(window, device.size - pos));		// faulted in as scanned
+	if (pos >= 2 * window) device.advise(pos - 2 * window, window, MADV_DONTNEED);
+	ahead = pos + window;
+}
+
+/*
+ * percent of scan range done, position, rate smoothed over reports and time left at that rate
+ * line is left for the next file line or report to clean and overwrite, never ended
+ */
+void Scan::report()
+{
+	auto now = chrono::steady_clock::now();
+	uint64_t end = context.last? context.last * context.sector: device.size;
+	if (end > device.size) end = device.size;
+	uint64_t at = min(offset + pos, end);		// scan passes -L in regions of no records
+	if (progress.from == UINT64_MAX) progress.from = at;
+	chrono::duration<double> elapsed = now - progress.shown;
+	if (elapsed.count() < 1) return;
+	double speed = (scanned() - progress.scanned) / elapsed.count();
+	progress.speed = progress.speed? 0.7 * progress.speed + 0.3 * speed: speed;
+	progress.scanned = scanned();
+	progress.shown = now;
+	cerr << clean << "Scan: ";
+	if (end > progress.from && at >= progress.from)
+		cerr << fixed << setprecision(1) << 100.0 * (at - progress.from) / (end - progress.from) << "% ";
+	cerr << '@' << hex << uppercase << 'x' << tell() << dec << fixed << setprecision(1) << ", " << progress.speed / MB << "MB/s";
+	if (progress.speed > 0 && end > at) {
+		uint64_t left = (end - at) / progress.speed;
+		cerr << ", ETA " << left / 3600 << ':' << setfill('0') << setw(2) << left / 60 % 60 << ':' << setw(2) << left % 60 << setfill(' ');
+	}
+	cerr << defaultfloat << '\r';
+}
+
+double Scan::rate() const {
+	chrono::duration<double> elapsed = chrono::steady_clock::now() - start;
+	return elapsed.count() > 0? scanned() / elapsed.count() / MB: 0;
+}
+
+ostream& operator<<(ostream& os, const Scan& scan) {
+	chrono::duration<double> elapsed = chrono::steady_clock::now() - scan.start;
+	os << clean << "Scanned: " << dec << scan.scanned() / MB << "MB in "
+		<< fixed << setprecision(1) << elapsed.count() << "s, "
+		<< scan.rate() << "MB/s";
+	if (scan.ring) os << ", queue:" << scan.slots.size();
+	else if (scan.device.mapped()) os << ", mapped";
+	if (scan.device.direct) os << ", direct:" << scan.device.block;
+	if (Context::verbose) os << ", search:" << Search::kernel();
+	if (scan.unused) os << ", free records skipped:" << dec << scan.unused;
+	if (scan.context.holes) os << ", sparse bytes skipped:" << dec << scan.context.holes;
+	return os << defaultfloat << endl;
+}
@@ -0,0 +1,74 @@
+#pragma once
+
+#include <iostream>
+#include <cstdint>
+#include <chrono>
+#include <vector>
+
+#include "device.hpp"
+#include "search.hpp"
+
+using LBA = uint64_t;
+
+struct Context;
+struct Entry;
+struct Ring;
+
+struct Scan {
+	struct Slot {					// window read, data preceded with room for carried over record
+		Buffer		buffer;
+		uint64_t	offset;
+		int			result;
+		bool		busy;
+	};
+	static const size_t head = 2 << 20;	// room for record carried over to next slot, largest NTFS cluster
+	const Device&	device;
+	Context&	context;
+	const char*	base;				// window begin, device map if mapped, slot buffer otherwise
+	size_t		pos, end;			// current and end of valid data offset in window
+	uint64_t	offset;				// device offset of window begin
+	uint64_t	origin;				// device offset the scan started at
+	uint64_t	done;				// bytes scanned before last seek
+	uint64_t	unused;				// mft records skipped as free in mft bitmap
+	uint64_t	ahead;				// window offset the mapped device was advised up to
+	bool		eof;
+	Ring*		ring;				// reads queued ahead of parser, nullptr for synchronous reads
+	std::vector<Slot> slots;		// one for synchronous reads, none for mapped device
+	size_t		slot;				// slot being parsed
+	bool		held;				// slot being parsed holds window data
+	uint64_t	next;				// device offset of next read to queue
+	Search		search;				// signature kernel settings of hits
+	std::vector<uint64_t> hits;		// candidate bitmap, a bit per sector from mark
+	uint64_t	mark;				// device offset of first sector in hits
+	size_t		marked;				// sectors covered by hits
+	std::chrono::steady_clock::time_point start;
+	struct {
+		std::chrono::steady_clock::time_point shown;	// last progress line
+		uint64_t	from;			// device offset of first progress line, percent done from it
+		uint64_t	scanned;		// bytes scanned at last progress line
+		double		speed;			// smoothed scan rate in bytes/s
+	} progress;
+
+	Scan(const Device&, Context&);
+	~Scan();
+	operator bool() const;
+	LBA tell() const;
+	bool seek(LBA);
+	const char* fill(size_t);		// make size bytes available at current position
+	void skip(size_t size) { pos += size; }
+	void pass();					// move to next candidate sector
+	uint64_t scanned() const { return done + offset + pos - origin; }
+	double rate() const;			// MB/s since scan start
+	friend Scan& operator>>(Scan&, Entry&);
+	private:
+	void advise();
+	void report();					// progress line, once a second at most
+	uint64_t bound() const;
+	void follow();
+	const char* dequeue(size_t);
+	void enqueue(size_t);
+	void load(Slot&, size_t);
+	void wait();
+};
+
+std::ostream& operator<<(std::ostream&, const Scan&);
@@ -0,0 +1,137 @@
+#include <cstring>
+#include <immintrin.h>
+
+#include "search.hpp"
+
+static const uint32_t FILE_KEY = 0x454C4946;				// "FILE"
+static const uint32_t INDX_KEY = 0x58444E49;				// "INDX"
+static const uint32_t BOOT_KEY = 0x4E9052EB;				// jump code 0xEB5290 and 'N'
+static const uint64_t BOOT_JMP = 0x005346544E9052EB;		// jump code and "NTFS"
+static const uint64_t BOOT_MASK = 0x00FFFFFFFFFFFFFF;
+
+static inline uint32_t load32(const char* data) {
+	uint32_t value;
+	memcpy(&value, data, sizeof(value));
+	return value;
+}
+
+bool Search::confirm(const char* data, size_t size) const
+{
+	uint32_t key = load32(data);
+	if (key == INDX_KEY) return index;
+	if (key == FILE_KEY) {
+		if (!tag || size < 0x20) return true;			// let the parser decide
+		uint32_t used = load32(data + 0x18);
+		uint32_t alloc = load32(data + 0x1C);
+		if (alloc > mft || used > alloc) return false;
+		if (used < 8 || used > size) return true;
+		return load32(data + used - 8) == 0xFFFFFFFF;
+	}
+	if (key == BOOT_KEY) {
+		uint64_t jmp;
+		memcpy(&jmp, data, sizeof(jmp));
+		if ((jmp & BOOT_MASK) != BOOT_JMP) return false;
+		if (size < 512) return true;
+		uint16_t end;
+		memcpy(&end, data + 510, sizeof(end));
+		return end == 0xAA55;
+	}
+	return false;
+}
+
+static size_t scalar(const Search& search, const char* data, size_t length, uint64_t* bitmap, size_t first)
+{
+	size_t count = 0;
+	size_t sectors = length / search.sector;
+	for (size_t i = first; i < sectors; i++) {
+		const char* at = data + i * search.sector;
+		uint32_t key = load32(at);
+		if (key != FILE_KEY && key != INDX_KEY && key != BOOT_KEY) continue;
+		if (!search.confirm(at, length - i * search.sector)) continue;
+		bitmap[i / 64] |= 1ULL << (i % 64);
+		count++;
+	}
+	return count;
+}
+
+__attribute__((target("sse4.2")))
+static size_t sse42(const Search& search, const char* data, size_t length, uint64_t* bitmap)
+{
+	size_t count = 0;
+	size_t sectors = length / search.sector;
+	size_t step = search.sector;
+	const __m128i file = _mm_set1_epi32(FILE_KEY);
+	const __m128i indx = _mm_set1_epi32(INDX_KEY);
+	const __m128i boot = _mm_set1_epi32(BOOT_KEY);
+	size_t i = 0;
+	for (; i + 4 <= sectors; i += 4) {
+		const char* at = data + i * step;
+		__m128i keys = _mm_cvtsi32_si128(load32(at));
+		keys = _mm_insert_epi32(keys, load32(at + step), 1);
+		keys = _mm_insert_epi32(keys, load32(at + 2 * step), 2);
+		keys = _mm_insert_epi32(keys, load32(at + 3 * step), 3);
+		__m128i hit = _mm_or_si128(_mm_cmpeq_epi32(keys, file),
+				_mm_or_si128(_mm_cmpeq_epi32(keys, indx), _mm_cmpeq_epi32(keys, boot)));
+		unsigned mask = _mm_movemask_ps(_mm_castsi128_ps(hit));
+		while (mask) {
+			size_t j = i + __builtin_ctz(mask);
+			mask &= mask - 1;
+			if (!search.confirm(data + j * step, length - j * step)) continue;
+			bitmap[j / 64] |= 1ULL << (j % 64);
+			count++;
+		}
+	}
+	return count + scalar(search, data, length, bitmap, i);
+}
+
+__attribute__((target("avx2")))
+static size_t avx2(const Search& search, const char* data, size_t length, uint64_t* bitmap)
+{
+	size_t count = 0;
+	size_t sectors = length / search.sector;
+	size_t step = search.sector;
+	const __m256i stride = _mm256_mullo_epi32(_mm256_setr_epi32(0, 1, 2, 3, 4, 5, 6, 7), _mm256_set1_epi32(step));
+	const __m256i file = _mm256_set1_epi32(FILE_KEY);
+	const __m256i indx = _mm256_set1_epi32(INDX_KEY);
+	const __m256i boot = _mm256_set1_epi32(BOOT_KEY);
+	size_t i = 0;
+	for (; i + 8 <= sectors; i += 8) {
+		__m256i keys = _mm256_i32gather_epi32(reinterpret_cast<const int*>(data + i * step), stride, 1);
+		__m256i hit = _mm256_or_si256(_mm256_cmpeq_epi32(keys, file),
+				_mm256_or_si256(_mm256_cmpeq_epi32(keys, indx), _mm256_cmpeq_epi32(keys, boot)));
+		unsigned mask = _mm256_movemask_ps(_mm256_castsi256_ps(hit));
+		while (mask) {
+			size_t j = i + __builtin_ctz(mask);
+			mask &= mask - 1;
+			if (!search.confirm(data + j * step, length - j * step)) continue;
+			bitmap[j / 64] |= 1ULL << (j % 64);
+			count++;
+		}
+	}
+	return count + scalar(search, data, length, bitmap, i);
+}
+
+using Kernel = size_t (*)(const Search&, const char*, size_t, uint64_t*);
+
+static size_t fallback(const Search& search, const char* data, size_t length, uint64_t* bitmap) {
+	return scalar(search, data, length, bitmap, 0);
+}
+
+static Kernel select(const char*& name) {
+	__builtin_cpu_init();
+	if (__builtin_cpu_supports("avx2")) return name = "avx2", avx2;
+	if (__builtin_cpu_supports("sse4.2")) return name = "sse4.2", sse42;
+	return name = "scalar", fallback;
+}
+
+static const char* name;
+static const Kernel kernel = select(name);
+
+const char* Search::kernel() { return name; }
+
+size_t Search::operator()(const char* data, size_t length, uint64_t* bitmap) const
+{
+	memset(bitmap, 0, (length / sector + 63) / 64 * sizeof(uint64_t));
+	if (sector < 8 * sizeof(uint32_t)) return fallback(*this, data, length, bitmap);
+	return ::kernel(*this, data, length, bitmap);
+}
@@ -0,0 +1,21 @@
+#pragma once
+
+#include <cstdint>
+#include <cstddef>
+
+/*
+ * signature search kernel over sector aligned offsets of a scan window
+ * a bit per sector is set in bitmap for NTFS boot sector, FILE record or INDX block
+ * FILE record with end tag checked if tag is set, INDX block only if index is set
+ * returns number of candidates found
+ */
+struct Search {
+	uint32_t	sector;				// sector size, distance between tested offsets
+	uint32_t	mft;				// max. MFT record size
+	bool		tag;				// check FILE record end tag
+	bool		index;				// INDX blocks are candidates
+
+	size_t operator()(const char*, size_t, uint64_t*) const;
+	static const char* kernel();	// name of kernel used on this CPU
+	bool confirm(const char*, size_t) const;	// scalar test of candidate within size bytes
+};
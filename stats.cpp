@@ -0,0 +1,101 @@
+#include <fstream>
+#include <iomanip>
+#include <cstring>
+
+#include "helper.hpp"
+#include "context.hpp"
+#include "stats.hpp"
+
+using namespace std;
+
+const char* Stats::phases[Phases] = { "scan", "parse", "recover", "wait", "query" };
+volatile sig_atomic_t Stats::signaled = 0;
+
+static void usr1(int) { Stats::signaled = 1; }
+
+Stats::Stats(): bytes(0), reads(0), seeks(0), errors(0), tail(0), valid(0), rejected(0), skipped(0), parsed(0),
+	hits(0), misses(0), files(0), written(0), waits(0), start(Clock::now()), next(start), period(0)
+{
+	for (auto& phase: time) phase = 0;
+}
+
+void Stats::setup(uint64_t seconds)
+{
+	period = chrono::seconds(seconds);
+	next = Clock::now() + period;
+	struct sigaction action = {};
+	action.sa_handler = usr1;
+	action.sa_flags = SA_RESTART;		// reads and waits interrupted go on
+	sigemptyset(&action.sa_mask);
+	sigaction(SIGUSR1, &action, nullptr);
+}
+
+bool Stats::due()
+{
+	if (signaled) {
+		signaled = 0;
+		return true;
+	}
+	if (!period.count()) return false;
+	Clock::time_point now = Clock::now();
+	if (now < next) return false;
+	next = now + period;
+	return true;
+}
+
+void Stats::read(uint64_t offset, int64_t size)
+{
+	add(reads);
+	if (size < 0) {
+		add(errors);
+		return;
+	}
+	add(bytes, size);
+	if (tail.exchange(offset + size, memory_order_relaxed) != offset) add(seeks);
+}
+
+ostream& operator<<(ostream& os, const Stats& stats) {
+	auto load = [](const Stats::Counter& counter) { return counter.load(memory_order_relaxed); };
+	chrono::duration<double> elapsed = Stats::Clock::now() - stats.start;
+	os << clean << "Stats: " << dec << fixed << setprecision(1) << elapsed.count() << "s, read:"
+		<< load(stats.bytes) / MB << "MB/" << load(stats.reads) << ", seeks:" << load(stats.seeks);
+	if (load(stats.errors)) os << ", errors:" << load(stats.errors);
+	os << ", records:" << load(stats.valid) << '/' << load(stats.rejected)
+		<< ", parsed:" << load(stats.parsed) << ", skipped:" << load(stats.skipped)
+		<< ", dirs:" << load(stats.hits) << '/' << load(stats.misses)
+		<< ", written:" << load(stats.files) << '/' << load(stats.written) / MB << "MB"
+		<< ", waits:" << load(stats.waits);
+	for (int phase = 0; phase < Stats::Phases; phase++)
+		if (load(stats.time[phase])) os << ", " << Stats::phases[phase] << ':' << load(stats.time[phase]) / 1e9 << 's';
+	return os << defaultfloat << endl;
+}
+
+/*
+ * counters and phase times in seconds as one JSON object, file replaced
+ */
+bool Stats::save(const string& path, const Context& context) const
+{
+	auto load = [](const Counter& counter) { return counter.load(memory_order_relaxed); };
+	ofstream json(path, ios::trunc);
+	if (!json.is_open()) {
+		cerr << "Can not write stats: " << path << ", error: " << strerror(errno) << endl;
+		return false;
+	}
+	chrono::duration<double> elapsed = Clock::now() - start;
+	json << fixed << setprecision(3) << "{\n"
+		<< "\t\"device\": \"" << escape(context.dev) << "\",\n"
+		<< "\t\"elapsed\": " << elapsed.count() << ",\n"
+		<< "\t\"read\": { \"bytes\": " << load(bytes) << ", \"sectors\": " << load(bytes) / context.sector
+		<< ", \"requests\": " << load(reads) << ", \"seeks\": " << load(seeks) << ", \"errors\": " << load(errors) << " },\n"
+		<< "\t\"records\": { \"valid\": " << load(valid) << ", \"rejected\": " << load(rejected)
+		<< ", \"skipped\": " << load(skipped) << ", \"parsed\": " << load(parsed) << " },\n"
+		<< "\t\"dirs\": { \"hits\": " << load(hits) << ", \"misses\": " << load(misses) << " },\n"
+		<< "\t\"written\": { \"files\": " << load(files) << ", \"bytes\": " << load(written)
+		<< ", \"holes\": " << context.holes << " },\n"
+		<< "\t\"waits\": " << load(waits) << ",\n"
+		<< "\t\"phases\": {";
+	for (int phase = 0; phase < Phases; phase++)
+		json << (phase? ", ": " ") << '"' << phases[phase] << "\": " << load(time[phase]) / 1e9;
+	json << " }\n}\n";
+	return bool(json);
+}
@@ -0,0 +1,45 @@
+#pragma once
+
+#include <iostream>
+#include <cstdint>
+#include <string>
+#include <atomic>
+#include <chrono>
+#include <csignal>
+
+struct Context;
+
+/*
+ * run counters, relaxed atomics added to by scan, parsing and recovery threads
+ * shown as a status line every -I seconds and on SIGUSR1, saved as JSON summary to -J file at exit
+ */
+struct Stats {
+	using Counter = std::atomic<uint64_t>;
+	using Clock = std::chrono::steady_clock;
+	enum Phase { Scan, Parse, Recover, Wait, Query, Phases };
+	static const char* phases[Phases];
+	static volatile sig_atomic_t signaled;	// SIGUSR1 received, status due
+	Counter		bytes, reads, seeks, errors;	// device reads, kernel copies included
+	Counter		tail;					// device offset past last read, seek if next read is elsewhere
+	Counter		valid, rejected;		// FILE records passed, failed record checks
+	Counter		skipped, parsed;		// records not decoded: not used or filtered, decoded into files
+	Counter		hits, misses;			// parent lookups of setPath in File::dirs
+	Counter		files, written;			// target files opened for write, bytes written
+	Counter		waits;					// scan thread waits for parsing or recovery threads
+	Counter		time[Phases];			// ns spent in each phase, summed over threads
+	Clock::time_point start, next;		// run start, next periodic status
+	Clock::duration	period;				// status period, none if zero
+
+	Stats();
+	void setup(uint64_t seconds);		// status period and SIGUSR1 handler
+	bool due();							// status line to show
+	void read(uint64_t offset, int64_t size);		// device read at offset, negative size on error
+	void add(Phase phase, Clock::time_point since) {
+		time[phase].fetch_add(std::chrono::duration_cast<std::chrono::nanoseconds>(Clock::now() - since).count(),
+			std::memory_order_relaxed);
+	}
+	static void add(Counter& counter, uint64_t value = 1) { counter.fetch_add(value, std::memory_order_relaxed); }
+	bool save(const std::string&, const Context&) const;		// JSON summary
+};
+
+std::ostream& operator<<(std::ostream&, const Stats&);
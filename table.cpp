@@ -0,0 +1,76 @@
+#include <iostream>
+#include <algorithm>
+
+#include "helper.hpp"
+#include "context.hpp"
+#include "file.hpp"
+#include "table.hpp"
+
+using namespace std;
+
+/*
+ * catalogue entry at offset as a row, its path added to paths if not there yet
+ */
+void Table::add(const Catalogue::Item* item, uint64_t offset)
+{
+	lba.push_back(item->lba);
+	index.push_back(item->index);
+	parent.push_back(item->parent);
+	flags.push_back(item->flags | (item->runs || item->flags & Catalogue::Resident? 0: Empty));
+	time.push_back(item->time);
+	size.push_back(item->size);
+	name.push_back(names.size());
+	length.push_back(item->name);
+	names.append(item->data, item->name);
+	auto id = ids.try_emplace(string(item->data + item->name, item->path), paths.size());
+	if (id.second) paths.push_back(&id.first->first);
+	path.push_back(id.first->second);
+	this->item.push_back(offset);
+}
+
+/*
+ * as File of the entry would be shown, filters of this run applied to columns
+ */
+bool Table::show(size_t row) const
+{
+	if (context.all) return true;
+	uint16_t flags = this->flags[row];
+	if (!(flags & Catalogue::Used) && !context.undel) return false;
+	string name(getName(row));
+	auto& filter = context.filter;
+	if (filter && !(filter.match(flags & Catalogue::Used, flags & Catalogue::Dir, size[row], time[row])
+		&& filter.match(getPath(row), name))) return false;
+	if (flags & Catalogue::Dir) return !context.recover && context.dirs;
+	if (flags & Empty) return false;
+	size_t dot = name.rfind('.');
+	bool valid = filter.hit(dot == name.npos? string(): name.substr(dot + 1), flags & Catalogue::Named);
+	if (valid && index[row] && flags & Catalogue::Trash) valid = context.recycle;
+	return valid;
+}
+
+vector<uint32_t> Table::select() const
+{
+	vector<uint32_t> rows;
+	for (size_t row = 0; row < this->rows(); row++)
+		if (show(row)) rows.push_back(row);
+	return rows;
+}
+
+/*
+ * rows ordered by name, size, time or path and name, catalogue order kept for equal keys
+ */
+void Table::sort(vector<uint32_t>& rows) const
+{
+	const string& key = context.order;
+	if (key == "name")
+		stable_sort(rows.begin(), rows.end(), [this](uint32_t a, uint32_t b) { return getName(a) < getName(b); });
+	else if (key == "size")
+		stable_sort(rows.begin(), rows.end(), [this](uint32_t a, uint32_t b) { return size[a] < size[b]; });
+	else if (key == "time")
+		stable_sort(rows.begin(), rows.end(), [this](uint32_t a, uint32_t b) { return time[a] < time[b]; });
+	else if (key == "path")
+		stable_sort(rows.begin(), rows.end(), [this](uint32_t a, uint32_t b) {
+			if (path[a] != path[b]) return getPath(a) < getPath(b);
+			return getName(a) < getName(b);
+		});
+}
@@ -0,0 +1,44 @@
+#pragma once
+
+#include <cstdint>
+#include <string>
+#include <string_view>
+#include <vector>
+#include <unordered_map>
+
+#include "catalogue.hpp"
+
+using LBA = uint64_t;
+
+struct Context;
+
+/*
+ * catalogue entries as columns, a row per entry, -F
+ * fixed width columns are filtered and sorted with no File made for rows filtered out,
+ * names are kept in an arena, paths once per directory, runs and resident data are left in the catalogue,
+ * row item is catalogue offset of the entry to make its File from, rows are numbered 32 bit, up to 2^32 - 1
+ */
+struct Table {
+	enum Flags: uint16_t { Empty = 0x100 };		// added to catalogue flags, no runs nor resident data
+	Context&	context;
+	std::vector<LBA>		lba;
+	std::vector<uint64_t>	index, parent;
+	std::vector<uint16_t>	flags;
+	std::vector<uint64_t>	time, size;
+	std::vector<uint64_t>	name;				// offset of name in names
+	std::vector<uint16_t>	length;				// name bytes
+	std::vector<uint32_t>	path;				// directory path of paths
+	std::vector<uint64_t>	item;				// catalogue offset of entry
+	std::string				names;
+	std::vector<const std::string*> paths;
+	std::unordered_map<std::string, uint32_t> ids;	// directory paths, each once
+
+	Table(Context& context): context(context) {}
+	size_t rows() const { return lba.size(); }
+	void add(const Catalogue::Item*, uint64_t);
+	std::string_view getName(size_t row) const { return std::string_view(names).substr(name[row], length[row]); }
+	const std::string& getPath(size_t row) const { return *paths[path[row]]; }
+	bool show(size_t) const;					// row is shown or recovered
+	std::vector<uint32_t> select() const;		// rows shown, in catalogue order
+	void sort(std::vector<uint32_t>&) const;	// by -o key
+};
@@ -0,0 +1,131 @@
+#include <iostream>
+#include <charconv>
+#include <cstring>
+
+#include "helper.hpp"
+#include "context.hpp"
+#include "file.hpp"
+#include "writer.hpp"
+
+using namespace std;
+
+static const size_t capacity = 64 * kB;		// line buffer, longer lines written in parts
+
+Writer::Writer(Context& context): context(context), format(Format::None), used(0)
+{
+	if (context.output.empty()) return;
+	if (context.output == "ndjson") format = Format::NDJSON;
+	else if (context.output == "csv") format = Format::CSV;
+	else return;
+	buffer.resize(capacity);
+	if (format == Format::CSV) put("lba,index,parent,type,path,name,time,access,size,extents\n");
+	flush();
+}
+
+Writer::~Writer() { flush(); }
+
+void Writer::flush()
+{
+	if (!used) return;
+	bool good = bool(cout);
+	cout.write(buffer.data(), used);
+	if (good && !cout) cerr << clean << "Output write error: " << strerror(errno) << endl;
+	used = 0;
+}
+
+void Writer::put(const char* data, size_t size)
+{
+	if (used + size > buffer.size()) {
+		flush();
+		if (size > buffer.size()) {			// longer than buffer, written as is
+			cout.write(data, size);
+			return;
+		}
+	}
+	memcpy(buffer.data() + used, data, size);
+	used += size;
+}
+
+void Writer::put(uint64_t value)
+{
+	char text[24];
+	put(text, to_chars(text, text + sizeof(text), value).ptr - text);
+}
+
+void Writer::put(int64_t value)
+{
+	char text[24];
+	put(text, to_chars(text, text + sizeof(text), value).ptr - text);
+}
+
+// JSON string, CSV field quoted with quotes doubled
+void Writer::text(const string& text)
+{
+	put('"');
+	if (format == Format::NDJSON) {
+		size_t plain = 0;
+		while (plain < text.size() && text[plain] != '"' && text[plain] != '\\' && (unsigned char)text[plain] >= 0x20) plain++;
+		if (plain == text.size()) put(text.data(), text.size());		// names rarely need escaping
+		else put(escape(text).c_str());
+	}
+	else for (char c: text) {
+		if (c == '"') put('"');
+		put(c);
+	}
+	put('"');
+}
+
+/*
+ * file line, shown as tab separated line would be, runs as device lba and sectors, sparse runs with no lba
+ */
+void Writer::add(const File& file)
+{
+	if (!file.done || !file.shown()) return;
+	file.context.dec();
+	bool json = format == Format::NDJSON;
+	auto field = [&](const char* name) {
+		if (json) {
+			put(*name == 'l'? "{\"": ",\"");
+			put(name);
+			put("\":");
+		}
+		else if (*name != 'l') put(',');
+	};
+	field("lba");
+	put(uint64_t(file.lba));
+	field("index");
+	put(file.index);
+	field("parent");
+	put(file.parent);
+	field("type");
+	text(file.getType());
+	field("path");
+	text(file.path);
+	field("name");
+	text(file.name);
+	field("time");
+	put(uint64_t(file.time));
+	field("access");
+	put(uint64_t(file.access));
+	field("size");
+	put(file.size);
+	field("extents");
+	put(json? '[': '"');
+	bool first = true;
+	for (auto& entry: file.runlist)
+		for (auto& run: entry.second.list) {
+			if (!first) put(json? ',': ' ');
+			first = false;
+			uint64_t sectors = (run.second - run.first) * context.sectors;
+			if (json) put('[');
+			if (Run::sparse(run)) put(json? "null": "hole");
+			else put(int64_t(run.first * context.sectors + context.bias));
+			put(json? ',': '+');
+			put(sectors);
+			if (json) put(']');
+		}
+	put(json? ']': '"');
+	if (json) put('}');
+	put('\n');
+	flush();
+}
@@ -0,0 +1,37 @@
+#pragma once
+
+#include <cstdint>
+#include <cstring>
+#include <string>
+#include <vector>
+
+struct Context;
+struct File;
+
+/*
+ * machine readable file lines to stdout, -E ndjson or csv, instead of the tab separated ones
+ * a line per file shown: lba, index, parent, type, path, name, times, size and extents as device lba and sectors
+ * a line is formatted into a buffer and written through cout when done, in order with other cout output,
+ * stdout is not flushed per line and nothing is left to lose on exit,
+ * all lines are written by the scan thread, buffer is not locked
+ */
+struct Writer {
+	enum class Format{ None, NDJSON, CSV };
+	Context&	context;
+	Format		format;
+	std::vector<char> buffer;
+	size_t		used;
+
+	Writer(Context&);
+	~Writer();
+	operator bool() const { return format != Format::None; }
+	void add(const File&);				// file line if shown, counted as processed with -s
+	void flush();
+	private:
+	void put(const char*, size_t);
+	void put(const char* text) { put(text, strlen(text)); }
+	void put(char c) { if (used == buffer.size()) flush(); buffer[used++] = c; }
+	void put(uint64_t);
+	void put(int64_t);
+	void text(const std::string&);		// quoted and escaped
+};